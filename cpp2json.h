@@ -1,19 +1,20 @@
 #pragma once
 
 #define __CPP2JSON_SERIALISE(x) 	template<class CPP2JSON_TYPE> void cpp2json_internal_serialise(CPP2JSON_TYPE& cpp2jsonObj) const { Cpp2JsonSuper::cpp2json_internal_serialise(cpp2jsonObj); cpp2jsonObj x; }	\
-									std::string Cpp2JsonGetSerialisationString() const																																\
+									std::string Cpp2JsonGetSerialisationString(Cpp2JsonWriteMode writeMode = Cpp2JsonWriteModeFull) const																			\
 									{																																												\
 											std::stringstream serialisationStream;																																	\
-											Cpp2JsonWriter jsonWriter = Cpp2JsonWriter(serialisationStream);																										\
+											Cpp2JsonWriter jsonWriter = Cpp2JsonWriter(serialisationStream, writeMode);																								\
 											jsonWriter.write(*this);																																				\
 											return serialisationStream.str();																																		\
 									}																																												\
 
 #define __CPP2JSON_DESERIALISE(x) 	template<class CPP2JSON_TYPE> void cpp2json_internal_deserialise(CPP2JSON_TYPE& cpp2jsonObj) { Cpp2JsonSuper::cpp2json_internal_deserialise(cpp2jsonObj); cpp2jsonObj x; }		\
-									void Cpp2JsonDeserialise(const std::string& serialisationStr)																													\
+									void Cpp2JsonDeserialise(const std::string& serialisationStr, Cpp2JsonStringPool* const stringPool = nullptr,																	\
+										Cpp2JsonParseBackend parseBackend = CPP2JSON_DEFAULT_PARSE_BACKEND)																											\
 									{																																												\
 										rapidjson::Document jsonDocument = rapidjson::Document();																													\
-										Cpp2JsonReader jsonReader = Cpp2JsonReader(serialisationStr, &jsonDocument);																								\
+										Cpp2JsonReader jsonReader = Cpp2JsonReader(serialisationStr, &jsonDocument, stringPool, parseBackend);																		\
 										jsonReader.read(*this);																																						\
 									}																																												\
 
@@ -142,12 +143,28 @@
 									)														\
 									friend class Cpp2JsonReader;							\
 									friend class Cpp2JsonWriter;							\
+									friend class Cpp2JsonSnapshotWriter;					\
+									friend class Cpp2JsonHasher;							\
+									friend class Cpp2JsonCloner;							\
 
 #define CPP2JSON_DECLARE_BASE_CLASS(BaseClassName) typedef BaseClassName Cpp2JsonSuper;
 
 #define __CPP2JSON_JSON_MAP_KEY_TAG "_json_map_key_"
 #define __CPP2JSON_JSON_MAP_VALUE_TAG "_json_map_value_"
 
+// Declares a name table for an enum, its values are then written as names instead of integers.
+// Must be used at global scope, e.g.:
+// CPP2JSON_DECLARE_ENUM_NAMES(Direction, { Direction::North, "north" }, { Direction::South, "south" })
+#define CPP2JSON_DECLARE_ENUM_NAMES(EnumType, ...)	template<> struct Cpp2JsonEnumNames<EnumType>											\
+													{																						\
+														static const Cpp2JsonEnumEntry<EnumType>* Entries(size_t& count)					\
+														{																					\
+															static const Cpp2JsonEnumEntry<EnumType> entries[] = { __VA_ARGS__ };			\
+															count = sizeof(entries) / sizeof(entries[0]);									\
+															return entries;																	\
+														}																					\
+													};
+
 #include "rapidjson/document.h"
 
 #include <sstream>
@@ -156,6 +173,59 @@
 #include <vector>
 #include <map>
 #include <stack>
+#include <unordered_set>
+#include <mutex>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <cstring>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define CPP2JSON_HAS_OPTIONAL 1
+#include <optional>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CPP2JSON_HAS_MMAP 1
+#define CPP2JSON_HAS_WRITEV 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#define CPP2JSON_HAS_USELOCALE 1
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#else
+#include <fstream>
+#include <clocale>
+#include <locale>
+#endif
+
+#if !defined(CPP2JSON_NO_SIMD)
+#if defined(__AVX2__)
+#define CPP2JSON_HAS_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPP2JSON_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__PCLMUL__) && (defined(__x86_64__) || defined(_M_X64))
+#define CPP2JSON_HAS_PCLMUL 1
+#include <wmmintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 class Cpp2JsonSerialisable
 {
@@ -169,467 +239,3974 @@ protected:
 	typedef Cpp2JsonSerialisable Cpp2JsonSuper;
 };
 
-class Cpp2JsonReader
+// Handle to a string owned by a Cpp2JsonStringPool.
+// Only a pointer is stored, identical values interned in the same pool share storage and compare by pointer.
+class Cpp2JsonInternedString
 {
 public:
 
-	Cpp2JsonReader(const std::string& inputStr, rapidjson::Document* const document)
+	Cpp2JsonInternedString()
+		: m_value(&EmptyString())
 	{
-		if (document->Parse<0>(inputStr.c_str()).HasParseError())
-        {
-            assert(false);
-        }
-
-		documentToParse.push(document);
 
 	}
 
-	template<class T>
-	auto read(T& obj) -> decltype(obj.cpp2json_internal_deserialise(*this), void())
+	inline const std::string& Get() const { return *m_value; }
+	inline const char* c_str() const { return m_value->c_str(); }
+	inline size_t size() const { return m_value->size(); }
+	inline bool empty() const { return m_value->empty(); }
+
+	inline bool operator==(const Cpp2JsonInternedString& other) const { return m_value == other.m_value || *m_value == *other.m_value; }
+	inline bool operator!=(const Cpp2JsonInternedString& other) const { return !(*this == other); }
+	inline bool operator<(const Cpp2JsonInternedString& other) const { return m_value != other.m_value && *m_value < *other.m_value; }
+
+private:
+
+	friend class Cpp2JsonStringPool;
+
+	explicit Cpp2JsonInternedString(const std::string* value)
+		: m_value(value)
 	{
-		obj = T();
 
-		obj.cpp2json_internal_deserialise(*this);
+	}
 
-		documentToParse.pop();
+	static const std::string& EmptyString()
+	{
+		static const std::string emptyString = std::string();
+		return emptyString;
 	}
-    
-    template<class T>
-    auto read(T* obj) -> decltype(obj->cpp2json_internal_deserialise(*this), void())
-    {
-        obj->cpp2json_internal_deserialise(*this);
 
-        documentToParse.pop();
-    }
-    
-    template<class T>
-    auto read(std::shared_ptr<T> obj) -> decltype(obj->cpp2json_internal_deserialise(*this), void())
-    {
-        obj->cpp2json_internal_deserialise(*this);
+	const std::string* m_value;
+};
 
-        documentToParse.pop();
-    }
+// Deduplicates string values, each distinct value is stored once for the lifetime of the pool.
+// Handles returned by Intern must not outlive the pool. Interning is thread safe, a pool can be shared between threads.
+class Cpp2JsonStringPool
+{
+public:
 
-	template<class T>
-	Cpp2JsonReader& operator()(const char* name, T& field)
+	Cpp2JsonStringPool()
 	{
-		auto document = documentToParse.top();
 
-		if (document->HasMember(name))
-		{
-			if ((*document)[name].IsObject())
-			{
-				const rapidjson::Value& itemElement = (*document)[name];
-				documentToParse.push(&itemElement);
-			}
+	}
 
-			read(field, name, *document);
+	inline Cpp2JsonInternedString Intern(const std::string& value)
+	{
+		return Intern(value.c_str(), value.size());
+	}
+
+	Cpp2JsonInternedString Intern(const char* value, size_t length)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Reuses the lookup key buffer so that values already in the pool are found without allocating.
+		m_lookupKey.assign(value, length);
+
+		auto it = m_strings.find(m_lookupKey);
+
+		if (it == m_strings.end())
+		{
+			it = m_strings.insert(m_lookupKey).first;
 		}
 
-		return *this;
+		return Cpp2JsonInternedString(&(*it));
+	}
+
+	size_t Size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_strings.size();
+	}
+
+	// Releases every value, handles interned before the call must no longer be used.
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_strings.clear();
+	}
+
+	// Pool used when no pool is given to a deserialisation call, shared by the whole process.
+	// It keeps every distinct value read until cleared, pass a pool to calls reading untrusted or unbounded input.
+	static Cpp2JsonStringPool& GetDefault()
+	{
+		static Cpp2JsonStringPool defaultPool;
+		return defaultPool;
 	}
 
 private:
 
-	template<class T>
-	auto read(T& obj, const char*  fieldName, const rapidjson::Value& document) -> decltype(obj.cpp2json_internal_deserialise(*this), void())
+	Cpp2JsonStringPool(const Cpp2JsonStringPool&) = delete;
+	Cpp2JsonStringPool& operator=(const Cpp2JsonStringPool&) = delete;
+
+	// Elements of an unordered_set are never relocated, handles stay valid across rehashes.
+	std::unordered_set<std::string> m_strings;
+	std::string m_lookupKey;
+
+	mutable std::mutex m_mutex;
+};
+
+template<class T>
+struct Cpp2JsonEnumEntry
+{
+	T value;
+	const char* name;
+};
+
+// Enums without a name table declared with CPP2JSON_DECLARE_ENUM_NAMES are written as integers.
+template<class T>
+struct Cpp2JsonEnumNames
+{
+	static const Cpp2JsonEnumEntry<T>* Entries(size_t& count)
 	{
-		obj = T();
+		count = 0;
+		return nullptr;
+	}
+};
 
-		obj.cpp2json_internal_deserialise(*this);
+// String with a fixed capacity stored inline, never allocates.
+// Longer values are truncated to Capacity characters.
+template<size_t Capacity>
+class Cpp2JsonInlineString
+{
+public:
 
-		documentToParse.pop();
+	Cpp2JsonInlineString()
+		: m_length(0)
+	{
+		m_data[0] = '\0';
 	}
 
-	template<class T>
-	auto read(T* obj, const char*  fieldName, const rapidjson::Value& document) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	Cpp2JsonInlineString(const char* value)
 	{
-		obj->cpp2json_internal_deserialise(*this);
+		assign(value, strlen(value));
+	}
 
-		documentToParse.pop();
+	Cpp2JsonInlineString(const std::string& value)
+	{
+		assign(value.c_str(), value.size());
 	}
 
-	template<class T>
-	auto read(std::shared_ptr<T> obj, const char*  fieldName, const rapidjson::Value& document) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	void assign(const char* value, size_t length)
 	{
-		obj->cpp2json_internal_deserialise(*this);
+		if (length > Capacity)
+		{
+			length = Capacity;
+		}
 
-		documentToParse.pop();
+		memcpy(m_data, value, length);
+		m_data[length] = '\0';
+		m_length = length;
 	}
 
-	void read(std::string& value, const char*  fieldName, const rapidjson::Value& document) 
+	inline const char* c_str() const { return m_data; }
+	inline size_t size() const { return m_length; }
+	inline bool empty() const { return m_length == 0; }
+	inline static constexpr size_t capacity() { return Capacity; }
+
+	inline bool operator==(const Cpp2JsonInlineString& other) const { return m_length == other.m_length && memcmp(m_data, other.m_data, m_length) == 0; }
+	inline bool operator!=(const Cpp2JsonInlineString& other) const { return !(*this == other); }
+	inline bool operator<(const Cpp2JsonInlineString& other) const { return strcmp(m_data, other.m_data) < 0; }
+
+private:
+
+	char m_data[Capacity + 1];
+	size_t m_length;
+};
+
+// Vector with a fixed capacity stored inline, never allocates.
+// Elements past Capacity are dropped, T must be default constructible.
+template<class T, size_t Capacity>
+class Cpp2JsonSmallVector
+{
+public:
+
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	Cpp2JsonSmallVector()
+		: m_size(0)
 	{
-		value = document[fieldName].GetString();
+
 	}
-    
-    void read(unsigned int& value, const char*  fieldName, const rapidjson::Value& document)
-    {
-        value = document[fieldName].GetUint();
-    }
-    
-    void read(uint64_t& value, const char*  fieldName, const rapidjson::Value& document)
-    {
-        value = document[fieldName].GetUint64();
-    }
 
-	void read(int& value, const char*  fieldName, const rapidjson::Value& document)
+	void push_back(const T& value)
 	{
-		value = document[fieldName].GetInt();
+		if (m_size < Capacity)
+		{
+			m_items[m_size++] = value;
+		}
 	}
-    
-    void read(int64_t& value, const char*  fieldName, const rapidjson::Value& document)
-    {
-        value = document[fieldName].GetInt64();
-    }
 
-	void read(float& value, const char* fieldName, const rapidjson::Value& document) 
+	// New elements are reset to T().
+	void resize(size_t size)
 	{
-		value = document[fieldName].GetFloat();
+		if (size > Capacity)
+		{
+			size = Capacity;
+		}
+
+		for (size_t i = m_size; i < size; ++i)
+		{
+			m_items[i] = T();
+		}
+
+		m_size = size;
 	}
 
-	void read(double& value, const char* fieldName, const rapidjson::Value& document) 
+	inline void clear() { m_size = 0; }
+	inline void pop_back() { assert(m_size > 0); --m_size; }
+
+	inline size_t size() const { return m_size; }
+	inline bool empty() const { return m_size == 0; }
+	inline static constexpr size_t capacity() { return Capacity; }
+
+	inline T& operator[](size_t index) { assert(index < m_size); return m_items[index]; }
+	inline const T& operator[](size_t index) const { assert(index < m_size); return m_items[index]; }
+
+	inline T* data() { return m_items; }
+	inline const T* data() const { return m_items; }
+
+	inline iterator begin() { return m_items; }
+	inline iterator end() { return m_items + m_size; }
+	inline const_iterator begin() const { return m_items; }
+	inline const_iterator end() const { return m_items + m_size; }
+
+	bool operator==(const Cpp2JsonSmallVector& other) const
 	{
-		value = document[fieldName].GetDouble();
+		if (m_size != other.m_size)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < m_size; ++i)
+		{
+			if (!(m_items[i] == other.m_items[i]))
+			{
+				return false;
+			}
+		}
+
+		return true;
 	}
-    
-    void read(bool& value, const char* fieldName, const rapidjson::Value& document)
-    {
-        value = document[fieldName].GetBool();
-    }
 
-	void readFromVectorEntry(std::string& value, const rapidjson::Value& document) 
+	inline bool operator!=(const Cpp2JsonSmallVector& other) const { return !(*this == other); }
+
+private:
+
+	T m_items[Capacity];
+	size_t m_size;
+};
+
+// True for values that can be copied and compared directly, without serialisable objects or pointers inside.
+template<class T>
+struct Cpp2JsonIsPlainValue : std::integral_constant<bool, !std::is_base_of<Cpp2JsonSerialisable, T>::value> {};
+
+template<class T>
+struct Cpp2JsonIsPlainValue<T*> : std::false_type {};
+
+template<class T>
+struct Cpp2JsonIsPlainValue<std::shared_ptr<T>> : std::false_type {};
+
+template<class T>
+struct Cpp2JsonIsPlainValue<std::vector<T>> : Cpp2JsonIsPlainValue<T> {};
+
+template<class T, size_t Size>
+struct Cpp2JsonIsPlainValue<std::array<T, Size>> : Cpp2JsonIsPlainValue<T> {};
+
+template<class T, size_t Capacity>
+struct Cpp2JsonIsPlainValue<Cpp2JsonSmallVector<T, Capacity>> : Cpp2JsonIsPlainValue<T> {};
+
+template<class T, class R>
+struct Cpp2JsonIsPlainValue<std::map<T, R>> : std::integral_constant<bool, Cpp2JsonIsPlainValue<T>::value && Cpp2JsonIsPlainValue<R>::value> {};
+
+template<class T, class R>
+struct Cpp2JsonIsPlainValue<std::pair<T, R>> : std::integral_constant<bool, Cpp2JsonIsPlainValue<T>::value && Cpp2JsonIsPlainValue<R>::value> {};
+
+template<>
+struct Cpp2JsonIsPlainValue<std::tuple<>> : std::true_type {};
+
+template<class T, class... R>
+struct Cpp2JsonIsPlainValue<std::tuple<T, R...>> : std::integral_constant<bool, Cpp2JsonIsPlainValue<T>::value && Cpp2JsonIsPlainValue<std::tuple<R...>>::value> {};
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+template<class T>
+struct Cpp2JsonIsPlainValue<std::optional<T>> : Cpp2JsonIsPlainValue<T> {};
+#endif
+
+// Collects the addresses of the serialisable fields of an object, in declaration order.
+class Cpp2JsonFieldCollector
+{
+public:
+
+	Cpp2JsonFieldCollector(std::vector<const void*>& fields)
+		: m_fields(fields)
 	{
-		value = document.GetString();
+
 	}
-    
-    void readFromVectorEntry(unsigned int& value, const rapidjson::Value& document)
-    {
-        value = document.GetUint();
-    }
-    
-    void readFromVectorEntry(uint64_t& value, const rapidjson::Value& document)
-    {
-        value = document.GetUint64();
-    }
 
-	void readFromVectorEntry(int& value, const rapidjson::Value& document)
+	template<class T>
+	Cpp2JsonFieldCollector& operator()(const char* name, const T& field)
 	{
-		value = document.GetInt();
+		m_fields.push_back(&field);
+		return *this;
 	}
-    
-    void readFromVectorEntry(int64_t& value, const rapidjson::Value& document)
-    {
-        value = document.GetInt64();
-    }
 
-	void readFromVectorEntry(float& value, const rapidjson::Value& document) 
+private:
+
+	std::vector<const void*>& m_fields;
+};
+
+enum Cpp2JsonParseBackend
+{
+	// Parses with rapidjson's own reader.
+	Cpp2JsonParseBackendRapidJson,
+	// Builds a structural index of the input with SIMD first, then fills the rapidjson document from it.
+	Cpp2JsonParseBackendStructuralIndex
+};
+
+#ifndef CPP2JSON_DEFAULT_PARSE_BACKEND
+#define CPP2JSON_DEFAULT_PARSE_BACKEND Cpp2JsonParseBackendRapidJson
+#endif
+
+// Two stage JSON parser, accepting the same input as rapidjson's reader and producing the same rapidjson document.
+// Numbers are always converted with full precision, as with rapidjson's kParseFullPrecisionFlag.
+// Stage one classifies 64 bytes at a time with AVX2 or SSE2 when the target supports them, scalar code otherwise,
+// and records the position of every structural character, quote and start of a literal or number.
+// Stage two walks those positions only, string contents and whitespace are never scanned byte by byte.
+class Cpp2JsonStructuralParser
+{
+public:
+
+	Cpp2JsonStructuralParser()
+		: m_structuralCapacity(0)
+		, m_structuralCount(0)
+		, m_input(nullptr)
+		, m_length(0)
 	{
-		value = document.GetFloat();
+
 	}
 
-	void readFromVectorEntry(double& value, const rapidjson::Value& document) 
+	// Parser used by the reader, one per thread so that its buffers are allocated once and reused by every parse.
+	// The index keeps the size needed by the largest input parsed on the thread, 4 bytes per input byte.
+	static Cpp2JsonStructuralParser& GetThreadDefault()
 	{
-		value = document.GetDouble();
+		static thread_local Cpp2JsonStructuralParser parser;
+		return parser;
 	}
-    
-    void readFromVectorEntry(bool& value, const rapidjson::Value& document)
-    {
-        value = document.GetBool();
-    }
 
-	template<class T>
-	auto readFromVectorEntry(T& obj, const rapidjson::Value& document) -> decltype(obj.cpp2json_internal_deserialise(*this), void())
+	bool Parse(const std::string& input, rapidjson::Document& document)
 	{
-		obj.cpp2json_internal_deserialise(*this);
+		return Parse(input.c_str(), input.size(), document);
 	}
 
-	template<class T>
-	void addNewVectorEntry(std::vector<T>& vector, const rapidjson::Value& document) 
+	// input must be null terminated at input[length].
+	// The index stores 32 bit positions, inputs of 4 GiB or more are rejected.
+	bool Parse(const char* input, size_t length, rapidjson::Document& document)
 	{
-		T newEntry = T();
+		if (length >= UINT32_MAX)
+		{
+			return false;
+		}
 
-		readFromVectorEntry(newEntry, document);
+		m_input = input;
+		m_length = length;
 
-		vector.push_back(newEntry);
+		if (!indexStructurals())
+		{
+			return false;
+		}
+
+		bool parsed = false;
+		DocumentGenerator generator = { this, &parsed };
+		document.Populate(generator);
+
+		return parsed;
+	}
+
+private:
+
+	struct BlockMasks
+	{
+		uint64_t quote;
+		uint64_t backslash;
+		uint64_t operators;
+		uint64_t whitespace;
+		uint64_t control;
+	};
+
+	struct Frame
+	{
+		bool isObject;
+		rapidjson::SizeType count;
+	};
+
+	struct DocumentGenerator
+	{
+		Cpp2JsonStructuralParser* parser;
+		bool* parsed;
+
+		template<class Handler>
+		bool operator()(Handler& handler)
+		{
+			*parsed = parser->generate(handler);
+			return *parsed;
+		}
+	};
+
+	static inline BlockMasks classify(const uint8_t* block)
+	{
+		BlockMasks masks;
+
+#if defined(CPP2JSON_HAS_AVX2)
+		__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+		__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+		masks.quote = movemask(equal(low, '"'), equal(high, '"'));
+		masks.backslash = movemask(equal(low, '\\'), equal(high, '\\'));
+		masks.operators = movemask(
+			_mm256_or_si256(_mm256_or_si256(_mm256_or_si256(equal(low, '{'), equal(low, '}')), _mm256_or_si256(equal(low, '['), equal(low, ']'))), _mm256_or_si256(equal(low, ':'), equal(low, ','))),
+			_mm256_or_si256(_mm256_or_si256(_mm256_or_si256(equal(high, '{'), equal(high, '}')), _mm256_or_si256(equal(high, '['), equal(high, ']'))), _mm256_or_si256(equal(high, ':'), equal(high, ','))));
+		masks.whitespace = movemask(
+			_mm256_or_si256(_mm256_or_si256(equal(low, ' '), equal(low, '\t')), _mm256_or_si256(equal(low, '\n'), equal(low, '\r'))),
+			_mm256_or_si256(_mm256_or_si256(equal(high, ' '), equal(high, '\t')), _mm256_or_si256(equal(high, '\n'), equal(high, '\r'))));
+		masks.control = movemask(isControl(low), isControl(high));
+#elif defined(CPP2JSON_HAS_SSE2)
+		masks.quote = 0;
+		masks.backslash = 0;
+		masks.operators = 0;
+		masks.whitespace = 0;
+		masks.control = 0;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+			int shift = 16 * i;
+
+			masks.quote |= movemask(equal(chunk, '"')) << shift;
+			masks.backslash |= movemask(equal(chunk, '\\')) << shift;
+			masks.operators |= movemask(_mm_or_si128(_mm_or_si128(_mm_or_si128(equal(chunk, '{'), equal(chunk, '}')), _mm_or_si128(equal(chunk, '['), equal(chunk, ']'))), _mm_or_si128(equal(chunk, ':'), equal(chunk, ',')))) << shift;
+			masks.whitespace |= movemask(_mm_or_si128(_mm_or_si128(equal(chunk, ' '), equal(chunk, '\t')), _mm_or_si128(equal(chunk, '\n'), equal(chunk, '\r')))) << shift;
+			masks.control |= movemask(isControl(chunk)) << shift;
+		}
+#else
+		masks.quote = 0;
+		masks.backslash = 0;
+		masks.operators = 0;
+		masks.whitespace = 0;
+		masks.control = 0;
+
+		for (int i = 0; i < 64; ++i)
+		{
+			uint64_t bit = 1ULL << i;
+
+			switch (block[i])
+			{
+				case '"': masks.quote |= bit; break;
+				case '\\': masks.backslash |= bit; break;
+				case '{': case '}': case '[': case ']': case ':': case ',': masks.operators |= bit; break;
+				case ' ': case '\t': case '\n': case '\r': masks.whitespace |= bit; break;
+				default: break;
+			}
+
+			if (block[i] < 0x20)
+			{
+				masks.control |= bit;
+			}
+		}
+#endif
+
+		return masks;
+	}
+
+#if defined(CPP2JSON_HAS_AVX2)
+	static inline __m256i equal(__m256i chunk, char character) { return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(character)); }
+	static inline uint64_t movemask(__m256i low, __m256i high) { return static_cast<uint32_t>(_mm256_movemask_epi8(low)) | (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(high))) << 32); }
+	static inline __m256i isControl(__m256i chunk) { return _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(0x1F)), chunk); }
+#elif defined(CPP2JSON_HAS_SSE2)
+	static inline __m128i equal(__m128i chunk, char character) { return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(character)); }
+	static inline uint64_t movemask(__m128i chunk) { return static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(chunk))); }
+	static inline __m128i isControl(__m128i chunk) { return _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x1F)), chunk); }
+#endif
+
+	// Bit i is set when an odd number of quotes is found at or before i.
+	static inline uint64_t prefixXor(uint64_t bits)
+	{
+#if defined(CPP2JSON_HAS_PCLMUL)
+		return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<int64_t>(bits)), _mm_set1_epi8(static_cast<char>(0xFF)), 0)));
+#else
+		bits ^= bits << 1;
+		bits ^= bits << 2;
+		bits ^= bits << 4;
+		bits ^= bits << 8;
+		bits ^= bits << 16;
+		bits ^= bits << 32;
+		return bits;
+#endif
+	}
+
+	static inline int trailingZeros(uint64_t bits)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return static_cast<int>(index);
+#else
+		int count = 0;
+
+		for (; (bits & 1) == 0; bits >>= 1)
+		{
+			++count;
+		}
+
+		return count;
+#endif
+	}
+
+	// Characters preceded by an odd number of backslashes, carrying backslash runs across blocks.
+	static inline uint64_t findEscaped(uint64_t backslash, uint64_t& previousEscaped)
+	{
+		const uint64_t evenBits = 0x5555555555555555ULL;
+
+		backslash &= ~previousEscaped;
+		uint64_t followsEscape = (backslash << 1) | previousEscaped;
+		uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+		uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+		previousEscaped = sequencesStartingOnEvenBits < oddSequenceStarts ? 1 : 0;
+		uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+
+		return (evenBits ^ invertMask) & followsEscape;
+	}
+
+	bool indexStructurals()
+	{
+		// Each block adds 64 positions at most. The index is only ever grown and left uninitialised, only written entries are read.
+		if (m_structuralCapacity < m_length + 64)
+		{
+			m_structuralCapacity = m_length + 64;
+			m_structurals.reset(new uint32_t[m_structuralCapacity]);
+		}
+
+		uint32_t* output = m_structurals.get();
+		uint64_t previousEscaped = 0;
+		uint64_t previousInString = 0;
+		uint64_t previousScalar = 0;
+		uint64_t controlInString = 0;
+
+		const uint8_t* input = reinterpret_cast<const uint8_t*>(m_input);
+		uint8_t lastBlock[64];
+
+		for (size_t blockStart = 0; blockStart < m_length; blockStart += 64)
+		{
+			const uint8_t* block = input + blockStart;
+
+			// The last block is padded with whitespace instead of reading past the input.
+			if (m_length - blockStart < 64)
+			{
+				memset(lastBlock, ' ', sizeof(lastBlock));
+				memcpy(lastBlock, block, m_length - blockStart);
+				block = lastBlock;
+			}
+
+			BlockMasks masks = classify(block);
+
+			uint64_t escaped = findEscaped(masks.backslash, previousEscaped);
+			uint64_t quote = masks.quote & ~escaped;
+
+			// Set from an opening quote up to the character before its closing quote.
+			uint64_t inString = prefixXor(quote) ^ previousInString;
+			previousInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+			// Control characters must be escaped inside strings.
+			controlInString |= masks.control & inString;
+
+			uint64_t operators = masks.operators & ~inString;
+			uint64_t scalar = ~(masks.operators | masks.whitespace | quote) & ~inString;
+			uint64_t scalarStart = scalar & ~((scalar << 1) | previousScalar);
+			previousScalar = scalar >> 63;
+
+			uint64_t structurals = operators | quote | scalarStart;
+
+			while (structurals != 0)
+			{
+				*output++ = static_cast<uint32_t>(blockStart + trailingZeros(structurals));
+				structurals &= structurals - 1;
+			}
+		}
+
+		m_structuralCount = static_cast<size_t>(output - m_structurals.get());
+
+		// An unterminated string leaves the last block inside a string.
+		return previousInString == 0 && controlInString == 0;
+	}
+
+	template<class Handler>
+	bool generate(Handler& handler)
+	{
+		enum State
+		{
+			ExpectValue,
+			ObjectStart,
+			ArrayStart,
+			ExpectKey,
+			AfterValue
+		};
+
+		m_stack.clear();
+
+		State state = ExpectValue;
+		size_t index = 0;
+
+		while (true)
+		{
+			if (state == AfterValue && m_stack.empty())
+			{
+				return index == m_structuralCount;
+			}
+
+			if (index >= m_structuralCount)
+			{
+				return false;
+			}
+
+			char character = m_input[m_structurals[index]];
+
+			switch (state)
+			{
+				case ExpectValue:
+				{
+					if (character == '{')
+					{
+						Frame frame = { true, 0 };
+						m_stack.push_back(frame);
+						++index;
+						state = ObjectStart;
+
+						if (!handler.StartObject())
+						{
+							return false;
+						}
+					}
+					else if (character == '[')
+					{
+						Frame frame = { false, 0 };
+						m_stack.push_back(frame);
+						++index;
+						state = ArrayStart;
+
+						if (!handler.StartArray())
+						{
+							return false;
+						}
+					}
+					else
+					{
+						if (!parseScalar(handler, index))
+						{
+							return false;
+						}
+
+						state = AfterValue;
+					}
+
+					break;
+				}
+				case ObjectStart:
+				case ArrayStart:
+				{
+					if (character == (state == ObjectStart ? '}' : ']'))
+					{
+						// Empty containers are closed by the AfterValue branch.
+						m_stack.back().count = static_cast<rapidjson::SizeType>(-1);
+						state = AfterValue;
+					}
+					else
+					{
+						state = state == ObjectStart ? ExpectKey : ExpectValue;
+					}
+
+					break;
+				}
+				case ExpectKey:
+				{
+					if (character != '"' || !parseString(handler, index, true))
+					{
+						return false;
+					}
+
+					if (index >= m_structuralCount || m_input[m_structurals[index]] != ':')
+					{
+						return false;
+					}
+
+					++index;
+					state = ExpectValue;
+					break;
+				}
+				case AfterValue:
+				{
+					Frame& frame = m_stack.back();
+					++frame.count;
+
+					if (character == ',')
+					{
+						++index;
+						state = frame.isObject ? ExpectKey : ExpectValue;
+					}
+					else if (character == (frame.isObject ? '}' : ']'))
+					{
+						bool closed = frame.isObject ? handler.EndObject(frame.count) : handler.EndArray(frame.count);
+
+						m_stack.pop_back();
+						++index;
+
+						if (!closed)
+						{
+							return false;
+						}
+					}
+					else
+					{
+						return false;
+					}
+
+					break;
+				}
+			}
+		}
+	}
+
+	template<class Handler>
+	bool parseScalar(Handler& handler, size_t& index)
+	{
+		uint32_t position = m_structurals[index];
+		char character = m_input[position];
+
+		if (character == '"')
+		{
+			return parseString(handler, index, false);
+		}
+
+		++index;
+
+		// The scalar must end where the next structural character, whitespace or the input starts.
+		const char* end = nullptr;
+		bool parsed = false;
+
+		if (character == 't')
+		{
+			parsed = matchLiteral(position, "true", end) && handler.Bool(true);
+		}
+		else if (character == 'f')
+		{
+			parsed = matchLiteral(position, "false", end) && handler.Bool(false);
+		}
+		else if (character == 'n')
+		{
+			parsed = matchLiteral(position, "null", end) && handler.Null();
+		}
+		else if (character == '-' || (character >= '0' && character <= '9'))
+		{
+			parsed = parseNumber(handler, m_input + position, end);
+		}
+
+		return parsed && isScalarEnd(*end);
+	}
+
+	bool matchLiteral(uint32_t position, const char* literal, const char*& end) const
+	{
+		size_t length = strlen(literal);
+
+		if (m_length - position < length || memcmp(m_input + position, literal, length) != 0)
+		{
+			return false;
+		}
+
+		end = m_input + position + length;
+		return true;
+	}
+
+	static inline bool isScalarEnd(char character)
+	{
+		switch (character)
+		{
+			case '\0': case ' ': case '\t': case '\n': case '\r':
+			case '{': case '}': case '[': case ']': case ':': case ',':
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	template<class Handler>
+	bool parseNumber(Handler& handler, const char* start, const char*& end)
+	{
+		static const double powersOfTen[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char* current = start;
+		bool negative = *current == '-';
+
+		if (negative)
+		{
+			++current;
+		}
+
+		if (*current < '0' || *current > '9')
+		{
+			return false;
+		}
+
+		// A leading zero is only valid on its own.
+		if (*current == '0' && current[1] >= '0' && current[1] <= '9')
+		{
+			return false;
+		}
+
+		// Digits that no longer fit in the mantissa only scale it, the value then goes through strtod.
+		uint64_t mantissa = 0;
+		bool truncated = false;
+		int exponent = 0;
+
+		for (; *current >= '0' && *current <= '9'; ++current)
+		{
+			if (!appendDigit(mantissa, *current))
+			{
+				truncated = true;
+				++exponent;
+			}
+		}
+
+		bool isInteger = true;
+
+		if (*current == '.')
+		{
+			isInteger = false;
+			++current;
+
+			if (*current < '0' || *current > '9')
+			{
+				return false;
+			}
+
+			for (; *current >= '0' && *current <= '9'; ++current)
+			{
+				if (appendDigit(mantissa, *current))
+				{
+					--exponent;
+				}
+				else
+				{
+					truncated = true;
+				}
+			}
+		}
+
+		if (*current == 'e' || *current == 'E')
+		{
+			isInteger = false;
+			++current;
+
+			bool negativeExponent = *current == '-';
+
+			if (*current == '-' || *current == '+')
+			{
+				++current;
+			}
+
+			if (*current < '0' || *current > '9')
+			{
+				return false;
+			}
+
+			int explicitExponent = 0;
+
+			for (; *current >= '0' && *current <= '9'; ++current)
+			{
+				if (explicitExponent < 100000)
+				{
+					explicitExponent = explicitExponent * 10 + (*current - '0');
+				}
+			}
+
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+		}
+
+		end = current;
+
+		if (isInteger && !truncated)
+		{
+			if (!negative)
+			{
+				return mantissa <= UINT32_MAX ? handler.Uint(static_cast<unsigned>(mantissa)) : handler.Uint64(mantissa);
+			}
+
+			if (mantissa <= 2147483648ULL)
+			{
+				return handler.Int(static_cast<int>(-static_cast<int64_t>(mantissa)));
+			}
+
+			if (mantissa <= 9223372036854775808ULL)
+			{
+				return handler.Int64(static_cast<int64_t>(0 - mantissa));
+			}
+		}
+
+		// Exact when both the mantissa and the power of ten are exactly representable, strtod handles the rest.
+		// Values too large for a double are rejected, as by rapidjson.
+		double value;
+
+		if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+		{
+			value = static_cast<double>(mantissa);
+			value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+			value = negative ? -value : value;
+		}
+		else
+		{
+			value = toDouble(start, end);
+
+			if (std::isinf(value))
+			{
+				return false;
+			}
+		}
+
+		return handler.Double(value);
+	}
+
+	// strtod follows the global locale, numbers are converted with the "C" locale's decimal point instead.
+	static double toDouble(const char* start, const char* end)
+	{
+#if defined(CPP2JSON_HAS_USELOCALE)
+		static const locale_t numericLocale = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+
+		locale_t previousLocale = uselocale(numericLocale);
+		double value = strtod(start, nullptr);
+		uselocale(previousLocale);
+
+		return value;
+#elif defined(_MSC_VER)
+		static const _locale_t numericLocale = _create_locale(LC_NUMERIC, "C");
+
+		return _strtod_l(start, nullptr, numericLocale);
+#else
+		const std::string number = std::string(start, end);
+		std::istringstream stream(number);
+		stream.imbue(std::locale::classic());
+
+		double value = 0.0;
+		stream >> value;
+
+		return stream.fail() ? HUGE_VAL : value;
+#endif
+	}
+
+	static inline bool appendDigit(uint64_t& mantissa, char digit)
+	{
+		const uint64_t limit = 1844674407370955161ULL;
+		uint64_t value = static_cast<uint64_t>(digit - '0');
+
+		if (mantissa > limit || (mantissa == limit && value > 5))
+		{
+			return false;
+		}
+
+		mantissa = mantissa * 10 + value;
+		return true;
+	}
+
+	template<class Handler>
+	bool parseString(Handler& handler, size_t& index, bool isKey)
+	{
+		// The closing quote is always the next structural, nothing inside a string is indexed.
+		if (index + 1 >= m_structuralCount)
+		{
+			return false;
+		}
+
+		const char* begin = m_input + m_structurals[index] + 1;
+		const char* end = m_input + m_structurals[index + 1];
+
+		index += 2;
+
+		if (*end != '"')
+		{
+			return false;
+		}
+
+		size_t length = static_cast<size_t>(end - begin);
+
+		if (memchr(begin, '\\', length) != nullptr)
+		{
+			if (!unescape(begin, end))
+			{
+				return false;
+			}
+
+			begin = m_scratch.data();
+			length = m_scratch.size();
+		}
+
+		rapidjson::SizeType size = static_cast<rapidjson::SizeType>(length);
+
+		return isKey ? handler.Key(begin, size, true) : handler.String(begin, size, true);
+	}
+
+	bool unescape(const char* begin, const char* end)
+	{
+		m_scratch.clear();
+
+		for (const char* current = begin; current < end; ++current)
+		{
+			if (*current != '\\')
+			{
+				m_scratch.push_back(*current);
+				continue;
+			}
+
+			if (++current == end)
+			{
+				return false;
+			}
+
+			switch (*current)
+			{
+				case '"': m_scratch.push_back('"'); break;
+				case '\\': m_scratch.push_back('\\'); break;
+				case '/': m_scratch.push_back('/'); break;
+				case 'b': m_scratch.push_back('\b'); break;
+				case 'f': m_scratch.push_back('\f'); break;
+				case 'n': m_scratch.push_back('\n'); break;
+				case 'r': m_scratch.push_back('\r'); break;
+				case 't': m_scratch.push_back('\t'); break;
+				case 'u':
+				{
+					uint32_t codePoint = 0;
+
+					if (!readHex(current + 1, end, codePoint))
+					{
+						return false;
+					}
+
+					current += 4;
+
+					// Surrogate pairs are two consecutive escapes, a low surrogate can not start one.
+					if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+					{
+						return false;
+					}
+
+					if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+					{
+						uint32_t lowSurrogate = 0;
+
+						if (end - current < 7 || current[1] != '\\' || current[2] != 'u' || !readHex(current + 3, end, lowSurrogate) || lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF)
+						{
+							return false;
+						}
+
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+						current += 6;
+					}
+
+					appendUtf8(codePoint);
+					break;
+				}
+				default:
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	static bool readHex(const char* begin, const char* end, uint32_t& value)
+	{
+		if (end - begin < 4)
+		{
+			return false;
+		}
+
+		value = 0;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			char character = begin[i];
+			value <<= 4;
+
+			if (character >= '0' && character <= '9')
+			{
+				value |= static_cast<uint32_t>(character - '0');
+			}
+			else if (character >= 'a' && character <= 'f')
+			{
+				value |= static_cast<uint32_t>(character - 'a' + 10);
+			}
+			else if (character >= 'A' && character <= 'F')
+			{
+				value |= static_cast<uint32_t>(character - 'A' + 10);
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void appendUtf8(uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			m_scratch.push_back(static_cast<char>(codePoint));
+		}
+		else if (codePoint < 0x800)
+		{
+			m_scratch.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+			m_scratch.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else if (codePoint < 0x10000)
+		{
+			m_scratch.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+			m_scratch.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			m_scratch.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else
+		{
+			m_scratch.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+			m_scratch.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+			m_scratch.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			m_scratch.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+	}
+
+	std::unique_ptr<uint32_t[]> m_structurals;
+	size_t m_structuralCapacity;
+	size_t m_structuralCount;
+
+	std::vector<Frame> m_stack;
+	std::string m_scratch;
+
+	const char* m_input;
+	size_t m_length;
+};
+
+class Cpp2JsonReader
+{
+public:
+
+	Cpp2JsonReader(const std::string& inputStr, rapidjson::Document* const document, Cpp2JsonStringPool* const pool = nullptr, Cpp2JsonParseBackend backend = CPP2JSON_DEFAULT_PARSE_BACKEND)
+		: stringPool(pool != nullptr ? pool : &Cpp2JsonStringPool::GetDefault())
+	{
+		if (backend == Cpp2JsonParseBackendStructuralIndex)
+		{
+			if (!Cpp2JsonStructuralParser::GetThreadDefault().Parse(inputStr, *document))
+			{
+				assert(false);
+			}
+		}
+		else if (document->Parse<0>(inputStr.c_str()).HasParseError())
+        {
+            assert(false);
+        }
+
+		documentToParse.push(document);
+
+	}
+
+	template<class T>
+	auto read(T& obj) -> decltype(obj.cpp2json_internal_deserialise(*this), void())
+	{
+		obj.cpp2json_internal_deserialise(*this);
+
+		documentToParse.pop();
+	}
+    
+    template<class T>
+    auto read(T* obj) -> decltype(obj->cpp2json_internal_deserialise(*this), void())
+    {
+        obj->cpp2json_internal_deserialise(*this);
+
+        documentToParse.pop();
+    }
+    
+    template<class T>
+    auto read(std::shared_ptr<T> obj) -> decltype(obj->cpp2json_internal_deserialise(*this), void())
+    {
+        obj->cpp2json_internal_deserialise(*this);
+
+        documentToParse.pop();
+    }
+
+	template<class T>
+	Cpp2JsonReader& operator()(const char* name, T& field)
+	{
+		auto document = documentToParse.top();
+
+		if (document->HasMember(name))
+		{
+			if ((*document)[name].IsObject())
+			{
+				const rapidjson::Value& itemElement = (*document)[name];
+				documentToParse.push(&itemElement);
+			}
+
+			read(field, name, *document);
+		}
+
+		return *this;
+	}
+
+private:
+
+	template<class T>
+	auto read(T& obj, const char*  fieldName, const rapidjson::Value& document) -> decltype(obj.cpp2json_internal_deserialise(*this), void())
+	{
+		obj.cpp2json_internal_deserialise(*this);
+
+		documentToParse.pop();
+	}
+
+	template<class T>
+	auto read(T* obj, const char*  fieldName, const rapidjson::Value& document) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	{
+		obj->cpp2json_internal_deserialise(*this);
+
+		documentToParse.pop();
+	}
+
+	template<class T>
+	auto read(std::shared_ptr<T> obj, const char*  fieldName, const rapidjson::Value& document) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	{
+		obj->cpp2json_internal_deserialise(*this);
+
+		documentToParse.pop();
+	}
+
+	void read(std::string& value, const char*  fieldName, const rapidjson::Value& document) 
+	{
+		value = document[fieldName].GetString();
+	}
+
+	void read(Cpp2JsonInternedString& value, const char*  fieldName, const rapidjson::Value& document) 
+	{
+		const rapidjson::Value& stringValue = document[fieldName];
+		value = stringPool->Intern(stringValue.GetString(), stringValue.GetStringLength());
+	}
+    
+    void read(unsigned int& value, const char*  fieldName, const rapidjson::Value& document)
+    {
+        value = document[fieldName].GetUint();
+    }
+    
+    void read(uint64_t& value, const char*  fieldName, const rapidjson::Value& document)
+    {
+        value = document[fieldName].GetUint64();
+    }
+
+	void read(int& value, const char*  fieldName, const rapidjson::Value& document)
+	{
+		value = document[fieldName].GetInt();
+	}
+    
+    void read(int64_t& value, const char*  fieldName, const rapidjson::Value& document)
+    {
+        value = document[fieldName].GetInt64();
+    }
+
+	void read(float& value, const char* fieldName, const rapidjson::Value& document) 
+	{
+		value = document[fieldName].GetFloat();
+	}
+
+	void read(double& value, const char* fieldName, const rapidjson::Value& document) 
+	{
+		value = document[fieldName].GetDouble();
+	}
+    
+    void read(bool& value, const char* fieldName, const rapidjson::Value& document)
+    {
+        value = document[fieldName].GetBool();
+    }
+
+	template<class T>
+	auto read(T& value, const char* fieldName, const rapidjson::Value& document) -> typename std::enable_if<std::is_enum<T>::value>::type
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+	template<size_t Capacity>
+	void read(Cpp2JsonInlineString<Capacity>& value, const char* fieldName, const rapidjson::Value& document)
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+	template<class T, size_t Capacity>
+	void read(Cpp2JsonSmallVector<T, Capacity>& value, const char* fieldName, const rapidjson::Value& document)
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+	template<class T, size_t Size>
+	void read(std::array<T, Size>& value, const char* fieldName, const rapidjson::Value& document)
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+	template<class T, class R>
+	void read(std::pair<T, R>& value, const char* fieldName, const rapidjson::Value& document)
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+	template<class... T>
+	void read(std::tuple<T...>& value, const char* fieldName, const rapidjson::Value& document)
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	template<class T>
+	void read(std::optional<T>& value, const char* fieldName, const rapidjson::Value& document)
+	{
+		const rapidjson::Value& optionalValue = document[fieldName];
+
+		readFromVectorEntry(value, optionalValue);
+
+		// Objects were pushed by operator() before reading the field.
+		if (optionalValue.IsObject())
+		{
+			documentToParse.pop();
+		}
+	}
+#endif
+
+	void readFromVectorEntry(std::string& value, const rapidjson::Value& document) 
+	{
+		value = document.GetString();
+	}
+
+	void readFromVectorEntry(Cpp2JsonInternedString& value, const rapidjson::Value& document) 
+	{
+		value = stringPool->Intern(document.GetString(), document.GetStringLength());
+	}
+    
+    void readFromVectorEntry(unsigned int& value, const rapidjson::Value& document)
+    {
+        value = document.GetUint();
+    }
+    
+    void readFromVectorEntry(uint64_t& value, const rapidjson::Value& document)
+    {
+        value = document.GetUint64();
+    }
+
+	void readFromVectorEntry(int& value, const rapidjson::Value& document)
+	{
+		value = document.GetInt();
+	}
+    
+    void readFromVectorEntry(int64_t& value, const rapidjson::Value& document)
+    {
+        value = document.GetInt64();
+    }
+
+	void readFromVectorEntry(float& value, const rapidjson::Value& document) 
+	{
+		value = document.GetFloat();
+	}
+
+	void readFromVectorEntry(double& value, const rapidjson::Value& document) 
+	{
+		value = document.GetDouble();
+	}
+    
+    void readFromVectorEntry(bool& value, const rapidjson::Value& document)
+    {
+        value = document.GetBool();
+    }
+
+	template<class T>
+	auto readFromVectorEntry(T& obj, const rapidjson::Value& document) -> decltype(obj.cpp2json_internal_deserialise(*this), void())
+	{
+		obj.cpp2json_internal_deserialise(*this);
+	}
+
+	// Enums are read from their declared name or from an integer.
+	template<class T>
+	auto readFromVectorEntry(T& value, const rapidjson::Value& document) -> typename std::enable_if<std::is_enum<T>::value>::type
+	{
+		if (document.IsString())
+		{
+			size_t count = 0;
+			const Cpp2JsonEnumEntry<T>* entries = Cpp2JsonEnumNames<T>::Entries(count);
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (strcmp(entries[i].name, document.GetString()) == 0)
+				{
+					value = entries[i].value;
+					return;
+				}
+			}
+
+			assert(false);
+		}
+		else if (document.IsInt64())
+		{
+			value = static_cast<T>(document.GetInt64());
+		}
+		else
+		{
+			value = static_cast<T>(document.GetUint64());
+		}
+	}
+
+	template<size_t Capacity>
+	void readFromVectorEntry(Cpp2JsonInlineString<Capacity>& value, const rapidjson::Value& document)
+	{
+		value.assign(document.GetString(), document.GetStringLength());
+	}
+
+	template<class T, size_t Capacity>
+	void readFromVectorEntry(Cpp2JsonSmallVector<T, Capacity>& value, const rapidjson::Value& document)
+	{
+		if (document.IsArray())
+		{
+			value.clear();
+			value.resize(document.Size() < Capacity ? document.Size() : Capacity);
+
+			for (rapidjson::SizeType i = 0; i < value.size(); i++)
+			{
+				readArrayEntry(value[i], document[i]);
+			}
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+
+	template<class T, size_t Size>
+	void readFromVectorEntry(std::array<T, Size>& value, const rapidjson::Value& document)
+	{
+		if (document.IsArray() && document.Size() == Size)
+		{
+			for (rapidjson::SizeType i = 0; i < Size; i++)
+			{
+				readArrayEntry(value[i], document[i]);
+			}
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+
+	// Pairs and tuples are stored as arrays of their elements.
+	template<class T, class R>
+	void readFromVectorEntry(std::pair<T, R>& value, const rapidjson::Value& document)
+	{
+		if (document.IsArray() && document.Size() == 2)
+		{
+			readArrayEntry(value.first, document[0]);
+			readArrayEntry(value.second, document[1]);
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+
+	template<class... T>
+	void readFromVectorEntry(std::tuple<T...>& value, const rapidjson::Value& document)
+	{
+		if (document.IsArray() && document.Size() == sizeof...(T))
+		{
+			readTupleEntries<0>(value, document);
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+
+	template<size_t Index, class... T>
+	auto readTupleEntries(std::tuple<T...>& value, const rapidjson::Value& document) -> typename std::enable_if<(Index < sizeof...(T))>::type
+	{
+		readArrayEntry(std::get<Index>(value), document[static_cast<rapidjson::SizeType>(Index)]);
+		readTupleEntries<Index + 1>(value, document);
+	}
+
+	template<size_t Index, class... T>
+	auto readTupleEntries(std::tuple<T...>& value, const rapidjson::Value& document) -> typename std::enable_if<Index == sizeof...(T)>::type
+	{
+
+	}
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	// Null clears the optional, objects must already be pushed by the caller.
+	template<class T>
+	void readFromVectorEntry(std::optional<T>& value, const rapidjson::Value& document)
+	{
+		if (document.IsNull())
+		{
+			value.reset();
+		}
+		else
+		{
+			if (!value.has_value())
+			{
+				value.emplace();
+			}
+
+			readFromVectorEntry(*value, document);
+		}
+	}
+#endif
+
+	// Reads an element of a fixed size array, pair or tuple.
+	template<class T>
+	void readArrayEntry(T& value, const rapidjson::Value& document)
+	{
+		bool isObject = document.IsObject();
+
+		if (isObject)
+		{
+			documentToParse.push(&document);
+		}
+
+		readFromVectorEntry(value, document);
+
+		if (isObject)
+		{
+			documentToParse.pop();
+		}
+	}
+
+	template<class T>
+	void addNewVectorEntry(std::vector<T>& vector, const rapidjson::Value& document) 
+	{
+		T newEntry = T();
+
+		readFromVectorEntry(newEntry, document);
+
+		vector.push_back(newEntry);
+	}
+
+	template<class T>
+	void addNewVectorEntry(std::vector<T*>& vector, const rapidjson::Value& document) 
+	{
+		T* newEntry = new T();
+
+		newEntry->cpp2json_internal_deserialise(*this);
+
+		vector.push_back(newEntry);
+	}
+
+	template<class T>
+	void addNewVectorEntry(std::vector<std::shared_ptr<T>>& vector, const rapidjson::Value& document) 
+	{
+		std::shared_ptr<T> newEntry = std::make_shared<T>();
+
+		newEntry->cpp2json_internal_deserialise(*this);
+
+		vector.push_back(newEntry);
+	}
+
+	template<typename T, typename R>
+	void addNewMapEntry(std::map<T, R>& map, T& key, const rapidjson::Value& document) 
+	{
+		R newValue = R();
+
+		read(newValue, __CPP2JSON_JSON_MAP_VALUE_TAG, document);
+
+		map[key] = newValue;
+	}
+
+	template<typename T, typename R>
+	void addNewMapEntry(std::map<T, R*>& map, T& key, const rapidjson::Value& document) 
+	{
+		R* newValue = new R();
+
+		read(newValue, __CPP2JSON_JSON_MAP_VALUE_TAG, document);
+
+		map[key] = newValue;
+	}
+
+	template<typename T, typename R>
+	void addNewMapEntry(std::map<T, std::shared_ptr<R>>& map, T& key, const rapidjson::Value& document) 
+	{
+		std::shared_ptr<R> newValue = std::make_shared<R>();
+
+		read(newValue, __CPP2JSON_JSON_MAP_VALUE_TAG, document);
+
+		map[key] = newValue;
+	}
+
+	template<class T>
+	void read(std::vector<T>& value, const char* fieldName, const rapidjson::Value& document) 
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+	template<typename T, typename R>
+	void read(std::map<T,R>& value, const char* fieldName, const rapidjson::Value& document) 
+	{
+		readFromVectorEntry(value, document[fieldName]);
+	}
+
+	// Vectors and maps nested in other containers, e.g. std::optional<std::vector<T>>.
+	template<class T>
+	void readFromVectorEntry(std::vector<T>& value, const rapidjson::Value& itemsArray) 
+	{
+		value = std::vector<T>();
+
+		if (itemsArray.IsArray())
+		{
+			for (rapidjson::SizeType i = 0; i < itemsArray.Size(); i++)
+			{
+				const rapidjson::Value& itemElement = itemsArray[i];
+
+				bool isObject = itemElement.IsObject();
+
+				if (isObject)
+				{
+					documentToParse.push(&itemElement);
+				}
+
+				addNewVectorEntry(value, itemElement);
+
+				if (isObject)
+				{
+					documentToParse.pop();	
+				}
+
+			}
+		}
+		else
+		{
+			assert(false);
+		}
+
+	}
+
+	template<typename T, typename R>
+	void readFromVectorEntry(std::map<T,R>& value, const rapidjson::Value& itemsArray) 
+	{
+		value = std::map<T,R>();
+
+		if (itemsArray.IsArray())
+		{
+			for (rapidjson::SizeType i = 0; i < itemsArray.Size(); i++)
+			{
+				const rapidjson::Value& itemElement = itemsArray[i];
+
+				if (itemElement.IsObject())
+				{
+					if (!(itemElement.HasMember(__CPP2JSON_JSON_MAP_KEY_TAG) && itemElement.HasMember(__CPP2JSON_JSON_MAP_VALUE_TAG)))
+					{
+						assert(false);
+					}
+					else
+					{
+						T newKey = T();
+						R newValue = R();
+
+						read(newKey, __CPP2JSON_JSON_MAP_KEY_TAG, itemElement);
+
+						if (itemElement[__CPP2JSON_JSON_MAP_VALUE_TAG].IsObject())
+						{
+							const rapidjson::Value& objToPush = itemElement[__CPP2JSON_JSON_MAP_VALUE_TAG];
+							documentToParse.push(&objToPush);
+						}
+
+						addNewMapEntry(value, newKey, itemElement);
+						
+					}
+				}
+				else
+				{
+					assert(false);
+				}
+				
+			}
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+
+	std::stack<const rapidjson::Value*> documentToParse;
+
+	Cpp2JsonStringPool* const stringPool;
+
+};
+
+// Piece of serialised output, laid out like struct iovec.
+struct Cpp2JsonSegment
+{
+	const char* data;
+	size_t size;
+};
+
+// Output stored as a chain of fixed size segments that is never concatenated.
+// Large immutable fragments are referenced instead of being copied into the chain.
+class Cpp2JsonSegmentChain : public std::streambuf
+{
+public:
+
+	Cpp2JsonSegmentChain(size_t segmentSize = 4096, size_t referenceThreshold = 256)
+		: m_segmentSize(segmentSize)
+		, m_referenceThreshold(referenceThreshold)
+		, m_nextBlock(0)
+		, m_closedSize(0)
+		, m_stream(this)
+	{
+		assert(segmentSize > 0 && segmentSize <= INT32_MAX);
+	}
+
+	inline std::ostream& GetStream() { return m_stream; }
+	inline size_t GetReferenceThreshold() const { return m_referenceThreshold; }
+
+	void Append(const char* data, size_t length)
+	{
+		m_stream.write(data, static_cast<std::streamsize>(length));
+	}
+
+	// The referenced data must stay valid and unchanged until the chain is written or cleared.
+	void AppendReference(const char* data, size_t length)
+	{
+		if (length == 0)
+		{
+			return;
+		}
+
+		closeSegment();
+
+		Cpp2JsonSegment segment = { data, length };
+		m_segments.push_back(segment);
+		m_closedSize += length;
+	}
+
+	// Keeps the fragment alive until the chain is cleared, e.g. cached output of a sub-object.
+	// The writer never calls it, fragments are appended by hand between writes.
+	void AppendShared(const std::shared_ptr<const std::string>& fragment)
+	{
+		m_fragments.push_back(fragment);
+		AppendReference(fragment->data(), fragment->size());
+	}
+
+	const std::vector<Cpp2JsonSegment>& GetSegments()
+	{
+		closeSegment();
+		return m_segments;
+	}
+
+	inline size_t Size() const { return m_closedSize + static_cast<size_t>(pptr() - pbase()); }
+
+	// Empties the chain, allocated blocks are kept for the next output.
+	void Clear()
+	{
+		m_segments.clear();
+		m_fragments.clear();
+		m_nextBlock = 0;
+		m_closedSize = 0;
+		setp(nullptr, nullptr);
+	}
+
+protected:
+
+	virtual int_type overflow(int_type character) override
+	{
+		closeSegment();
+		nextBlock();
+
+		if (!traits_type::eq_int_type(character, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(character);
+			pbump(1);
+		}
+
+		return traits_type::not_eof(character);
+	}
+
+	virtual std::streamsize xsputn(const char* data, std::streamsize length) override
+	{
+		std::streamsize written = 0;
+
+		while (written < length)
+		{
+			if (pptr() == epptr())
+			{
+				closeSegment();
+				nextBlock();
+			}
+
+			std::streamsize available = epptr() - pptr();
+			std::streamsize count = length - written < available ? length - written : available;
+
+			memcpy(pptr(), data + written, static_cast<size_t>(count));
+			pbump(static_cast<int>(count));
+			written += count;
+		}
+
+		return written;
+	}
+
+private:
+
+	Cpp2JsonSegmentChain(const Cpp2JsonSegmentChain&) = delete;
+	Cpp2JsonSegmentChain& operator=(const Cpp2JsonSegmentChain&) = delete;
+
+	// Moves the bytes written since the last segment into a new segment, writing continues after them.
+	void closeSegment()
+	{
+		if (pptr() != pbase())
+		{
+			Cpp2JsonSegment segment = { pbase(), static_cast<size_t>(pptr() - pbase()) };
+			m_segments.push_back(segment);
+			m_closedSize += segment.size;
+		}
+
+		setp(pptr(), epptr());
+	}
+
+	void nextBlock()
+	{
+		if (m_nextBlock == m_blocks.size())
+		{
+			m_blocks.push_back(std::unique_ptr<char[]>(new char[m_segmentSize]));
+		}
+
+		char* block = m_blocks[m_nextBlock++].get();
+		setp(block, block + m_segmentSize);
+	}
+
+	size_t m_segmentSize;
+	size_t m_referenceThreshold;
+
+	std::vector<std::unique_ptr<char[]>> m_blocks;
+	size_t m_nextBlock;
+
+	std::vector<Cpp2JsonSegment> m_segments;
+	std::vector<std::shared_ptr<const std::string>> m_fragments;
+	size_t m_closedSize;
+
+	std::ostream m_stream;
+};
+
+enum Cpp2JsonWriteMode
+{
+	// Writes every serialisable field.
+	Cpp2JsonWriteModeFull,
+	// Skips fields equal to their value in a default constructed object, the reader leaves them untouched.
+	// Objects must be read into default constructed objects.
+	Cpp2JsonWriteModeSparse
+};
+
+// Copied from:
+// https://gist.github.com/judofyr/18cc1e9e4f48a13483c00d1c86e34cf5
+
+class Cpp2JsonWriter 
+{
+
+public:
+
+	Cpp2JsonWriter(std::ostream& output, Cpp2JsonWriteMode mode = Cpp2JsonWriteModeFull) 
+		: m_output(output)
+		, m_chain(nullptr)
+		, m_needsComma(false)
+		, m_mode(mode)
+		, m_compareDefaults(false)
+		, m_nextDefaultField(0)
+	{
+
+	}
+
+	// Long strings are referenced by the chain instead of being copied, they must not change until it is written.
+	Cpp2JsonWriter(Cpp2JsonSegmentChain& chain, Cpp2JsonWriteMode mode = Cpp2JsonWriteModeFull) 
+		: m_output(chain.GetStream())
+		, m_chain(&chain)
+		, m_needsComma(false)
+		, m_mode(mode)
+		, m_compareDefaults(false)
+		, m_nextDefaultField(0)
+	{
+
+	}
+
+	template<class T>
+	auto write(const T& obj) -> decltype(obj.cpp2json_internal_serialise(*this), void())
+	{
+		writeObject<T>(obj, nullptr);
+	}
+
+	template<class T>
+	Cpp2JsonWriter& operator()(const char* name, const T& field)
+	{
+		const T* defaultField = nullptr;
+
+		if (m_compareDefaults)
+		{
+			// Fields are visited in the same order in the default object, the default field has the same type.
+			defaultField = static_cast<const T*>(m_defaultFields[m_nextDefaultField++]);
+
+			if (isDefault(field, *defaultField))
+			{
+				return *this;
+			}
+		}
+
+		if (m_needsComma) 
+		{
+			m_output << ",";
+		}
+		m_needsComma = true;
+		m_output << "\"" << name << "\"" << ":";
+		writeValue(field, defaultField);
+		return *this;
+	}
+
+private:
+
+	template<class T>
+	auto write(const T* obj) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	{
+		writeObject<T>(*obj, nullptr);
+	}
+
+	template<class T>
+	auto write(const std::shared_ptr<T> obj) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	{
+		writeObject<T>(*obj, nullptr);
+	}
+
+	// Objects are compared to their counterpart in the default object when they have one, to a default constructed T otherwise.
+	template<class T>
+	void writeObject(const T& obj, const T* defaultObj)
+	{
+		bool needsComma = m_needsComma;
+
+		m_output << "{";
+		m_needsComma = false;
+
+		if (m_mode == Cpp2JsonWriteModeSparse && defaultObj == nullptr)
+		{
+			defaultObj = defaultInstance<T>();
+		}
+
+		if (defaultObj != nullptr)
+		{
+			bool compareDefaults = m_compareDefaults;
+			size_t firstField = m_defaultFields.size();
+			size_t nextField = m_nextDefaultField;
+
+			Cpp2JsonFieldCollector collector = Cpp2JsonFieldCollector(m_defaultFields);
+			defaultObj->cpp2json_internal_serialise(collector);
+
+			m_compareDefaults = true;
+			m_nextDefaultField = firstField;
+			obj.cpp2json_internal_serialise(*this);
+
+			m_defaultFields.resize(firstField);
+			m_nextDefaultField = nextField;
+			m_compareDefaults = compareDefaults;
+		}
+		else
+		{
+			obj.cpp2json_internal_serialise(*this);
+		}
+
+		m_output << "}";
+		m_needsComma = needsComma;
+	}
+
+	// Constructed once per class, the first time an object of that class is written in sparse mode.
+	template<class T>
+	static auto defaultInstance() -> typename std::enable_if<std::is_default_constructible<T>::value, const T*>::type
+	{
+		static const T instance = T();
+		return &instance;
+	}
+
+	template<class T>
+	static auto defaultInstance() -> typename std::enable_if<!std::is_default_constructible<T>::value, const T*>::type
+	{
+		return nullptr;
+	}
+
+	// Objects and pointers are never skipped, their fields are compared instead.
+	template<class T>
+	static auto isDefault(const T& value, const T& defaultValue) -> typename std::enable_if<Cpp2JsonIsPlainValue<T>::value, bool>::type
+	{
+		return value == defaultValue;
+	}
+
+	template<class T>
+	static auto isDefault(const T& value, const T& defaultValue) -> typename std::enable_if<!Cpp2JsonIsPlainValue<T>::value, bool>::type
+	{
+		return false;
+	}
+
+	// Containers of objects are only skipped when empty in both.
+	template<class T>
+	static bool isDefault(const std::vector<T>& value, const std::vector<T>& defaultValue)
+	{
+		if (value.size() != defaultValue.size())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < value.size(); ++i)
+		{
+			if (!isDefault(value[i], defaultValue[i]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template<class T, class R>
+	static bool isDefault(const std::map<T, R>& value, const std::map<T, R>& defaultValue)
+	{
+		if (value.size() != defaultValue.size())
+		{
+			return false;
+		}
+
+		for (auto it = value.begin(), defaultIt = defaultValue.begin(); it != value.end(); ++it, ++defaultIt)
+		{
+			if (!(it->first == defaultIt->first && isDefault(it->second, defaultIt->second)))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	template<class T>
+	static bool isDefault(const std::optional<T>& value, const std::optional<T>& defaultValue)
+	{
+		if (value.has_value() && defaultValue.has_value())
+		{
+			return isDefault(*value, *defaultValue);
+		}
+
+		return value.has_value() == defaultValue.has_value();
+	}
+#endif
+
+	// Writes a value along with its counterpart in the default object, null when it has none.
+	// The reader fills objects, pointees, arrays, pairs, tuples and optionals in place, so their counterparts are passed on.
+	// Vectors, maps and small vectors are rebuilt from default constructed entries, their elements have no counterpart.
+	template<class T>
+	auto writeValue(const T& value, const T* defaultValue) -> decltype(value.cpp2json_internal_serialise(*this), void())
+	{
+		writeObject(value, defaultValue);
+	}
+
+	template<class T>
+	auto writeValue(T* const& value, T* const* defaultValue) -> decltype(value->cpp2json_internal_serialise(*this), void())
+	{
+		writeObject(*value, defaultValue != nullptr ? *defaultValue : nullptr);
+	}
+
+	template<class T>
+	auto writeValue(const std::shared_ptr<T>& value, const std::shared_ptr<T>* defaultValue) -> decltype(value->cpp2json_internal_serialise(*this), void())
+	{
+		writeObject(*value, defaultValue != nullptr ? defaultValue->get() : nullptr);
+	}
+
+	template<class T, size_t Size>
+	void writeValue(const std::array<T, Size>& value, const std::array<T, Size>* defaultValue)
+	{
+		m_output << "[";
+
+		for (size_t i = 0; i < Size; ++i)
+		{
+			if (i > 0)
+			{
+				m_output << ",";
+			}
+
+			writeValue(value[i], defaultValue != nullptr ? &(*defaultValue)[i] : nullptr);
+		}
+
+		m_output << "]";
+	}
+
+	template<class T, class R>
+	void writeValue(const std::pair<T, R>& value, const std::pair<T, R>* defaultValue)
+	{
+		m_output << "[";
+		writeValue(value.first, defaultValue != nullptr ? &defaultValue->first : nullptr);
+		m_output << ",";
+		writeValue(value.second, defaultValue != nullptr ? &defaultValue->second : nullptr);
+		m_output << "]";
+	}
+
+	template<class... T>
+	void writeValue(const std::tuple<T...>& value, const std::tuple<T...>* defaultValue)
+	{
+		m_output << "[";
+		writeTupleEntries<0>(value, defaultValue);
+		m_output << "]";
+	}
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	template<class T>
+	void writeValue(const std::optional<T>& value, const std::optional<T>* defaultValue)
+	{
+		if (value.has_value())
+		{
+			writeValue(*value, defaultValue != nullptr && defaultValue->has_value() ? &**defaultValue : nullptr);
+		}
+		else
+		{
+			m_output << "null";
+		}
+	}
+#endif
+
+	template<class T>
+	void writeValue(const T& value, const void* defaultValue)
+	{
+		write(value);
+	}
+    
+    void write(unsigned int value)
+    {
+        m_output << value;
+    }
+    
+    void write(uint64_t value)
+    {
+        m_output << value;
+    }
+
+	void write(int value)
+	{
+		m_output << value;
+	}
+    
+    void write(int64_t value)
+    {
+        m_output << value;
+    }
+
+	void write(float value) 
+	{
+		m_output << value;
+	}
+
+	void write(double value) 
+	{
+		m_output << value;
+	}
+
+	void write(const std::string& value) 
+	{
+		writeString(value.c_str(), value.size());
+	}
+
+	void write(const Cpp2JsonInternedString& value) 
+	{
+		writeString(value.c_str(), value.size());
+	}
+    
+    void write(bool value)
+    {
+        m_output << (value ? "true" : "false");
+    }
+
+	// Enums are written by name when a name table is declared, as integers otherwise.
+	template<class T>
+	auto write(T value) -> typename std::enable_if<std::is_enum<T>::value>::type
+	{
+		size_t count = 0;
+		const Cpp2JsonEnumEntry<T>* entries = Cpp2JsonEnumNames<T>::Entries(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (entries[i].value == value)
+			{
+				m_output << '"' << entries[i].name << '"';
+				return;
+			}
+		}
+
+		if (std::is_signed<typename std::underlying_type<T>::type>::value)
+		{
+			m_output << static_cast<int64_t>(value);
+		}
+		else
+		{
+			m_output << static_cast<uint64_t>(value);
+		}
+	}
+
+	template<size_t Capacity>
+	void write(const Cpp2JsonInlineString<Capacity>& value)
+	{
+		m_output << '"';
+		m_output.write(value.c_str(), value.size());
+		m_output << '"';
+	}
+
+	template<class T, size_t Capacity>
+	void write(const Cpp2JsonSmallVector<T, Capacity>& value)
+	{
+		writeArray(value.begin(), value.end());
+	}
+
+	template<class T, size_t Size>
+	void write(const std::array<T, Size>& value)
+	{
+		const std::array<T, Size>* noDefault = nullptr;
+		writeValue(value, noDefault);
+	}
+
+	template<class T, class R>
+	void write(const std::pair<T, R>& value)
+	{
+		const std::pair<T, R>* noDefault = nullptr;
+		writeValue(value, noDefault);
+	}
+
+	template<class... T>
+	void write(const std::tuple<T...>& value)
+	{
+		const std::tuple<T...>* noDefault = nullptr;
+		writeValue(value, noDefault);
+	}
+
+	template<size_t Index, class... T>
+	auto writeTupleEntries(const std::tuple<T...>& value, const std::tuple<T...>* defaultValue) -> typename std::enable_if<(Index < sizeof...(T))>::type
+	{
+		if (Index > 0)
+		{
+			m_output << ",";
+		}
+
+		writeValue(std::get<Index>(value), defaultValue != nullptr ? &std::get<Index>(*defaultValue) : nullptr);
+		writeTupleEntries<Index + 1>(value, defaultValue);
+	}
+
+	template<size_t Index, class... T>
+	auto writeTupleEntries(const std::tuple<T...>& value, const std::tuple<T...>* defaultValue) -> typename std::enable_if<Index == sizeof...(T)>::type
+	{
+
+	}
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	template<class T>
+	void write(const std::optional<T>& value)
+	{
+		const std::optional<T>* noDefault = nullptr;
+		writeValue(value, noDefault);
+	}
+#endif
+
+	template<class Iterator>
+	void writeArray(Iterator begin, Iterator end)
+	{
+		m_output << "[";
+
+		for (Iterator it = begin; it != end; ++it)
+		{
+			if (it != begin)
+			{
+				m_output << ",";
+			}
+
+			write(*it);
+		}
+
+		m_output << "]";
+	}
+
+	template<class T>
+	void write(const std::vector<T>& value) 
+	{
+		m_output << "[";
+
+		for (size_t i = 0; i < value.size(); ++i)
+		{
+			write(value.at(i));
+
+			if (i < value.size() - 1)
+			{
+				m_output << ",";
+			}
+		}
+
+		m_output << "]";
+	}
+
+	template<typename T, typename R>
+	void write(const std::map<T,R>& value) 
+	{
+		m_output << "[";
+
+		for( auto it = value.begin(); it != value.end();)
+		{
+			m_output << "{ \"" << __CPP2JSON_JSON_MAP_KEY_TAG << "\": ";
+			write(it->first);
+
+			m_output << ", \"" << __CPP2JSON_JSON_MAP_VALUE_TAG << "\": ";
+			write(it->second);
+
+			m_output << "}";
+
+			++it;
+
+			if (it != value.end())
+			{
+				m_output << ",";
+			}
+		}
+
+		m_output << "]";
+	}
+
+	void writeString(const char* value, size_t length)
+	{
+		m_output << '"';
+
+		if (m_chain != nullptr && length >= m_chain->GetReferenceThreshold())
+		{
+			m_chain->AppendReference(value, length);
+		}
+		else
+		{
+			m_output.write(value, static_cast<std::streamsize>(length));
+		}
+
+		m_output << '"';
+	}
+
+	std::ostream& m_output;
+	Cpp2JsonSegmentChain* m_chain;
+	bool m_needsComma;
+
+	Cpp2JsonWriteMode m_mode;
+
+	// Field addresses of the default objects being compared against, one range per nested object.
+	std::vector<const void*> m_defaultFields;
+	bool m_compareDefaults;
+	size_t m_nextDefaultField;
+};
+
+#ifdef CPP2JSON_HAS_WRITEV
+// Writes the chain to a file descriptor, preceded by its length as a 4 byte big endian integer.
+// Segments are handed to writev as they are, the output is never concatenated.
+// Returns false without writing anything when the chain does not fit in the 4 byte length.
+inline bool Cpp2JsonWriteFramed(int fileDescriptor, Cpp2JsonSegmentChain& chain)
+{
+	const std::vector<Cpp2JsonSegment>& segments = chain.GetSegments();
+	size_t size = chain.Size();
+
+	if (size > UINT32_MAX)
+	{
+		return false;
+	}
+
+	unsigned char header[4] =
+	{
+		static_cast<unsigned char>(size >> 24),
+		static_cast<unsigned char>(size >> 16),
+		static_cast<unsigned char>(size >> 8),
+		static_cast<unsigned char>(size)
+	};
+
+	const size_t batchSize = 64;
+	struct iovec batch[batchSize];
+
+	// Entry 0 is the header, entry i > 0 is segments[i - 1]. offset is the part of the current entry already written.
+	size_t entry = 0;
+	size_t offset = 0;
+	size_t entryCount = segments.size() + 1;
+
+	while (entry < entryCount)
+	{
+		int batchCount = 0;
+
+		for (size_t i = entry; i < entryCount && batchCount < static_cast<int>(batchSize); ++i, ++batchCount)
+		{
+			const char* data = i == 0 ? reinterpret_cast<const char*>(header) : segments[i - 1].data;
+			size_t length = i == 0 ? sizeof(header) : segments[i - 1].size;
+			size_t skip = i == entry ? offset : 0;
+
+			batch[batchCount].iov_base = const_cast<char*>(data + skip);
+			batch[batchCount].iov_len = length - skip;
+		}
+
+		ssize_t written = writev(fileDescriptor, batch, batchCount);
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		// Advances past the entries written completely, a partial write resumes inside an entry.
+		size_t remaining = static_cast<size_t>(written);
+
+		for (int i = 0; i < batchCount && remaining > 0; ++i)
+		{
+			if (remaining < batch[i].iov_len)
+			{
+				offset += remaining;
+				remaining = 0;
+			}
+			else
+			{
+				remaining -= batch[i].iov_len;
+				++entry;
+				offset = 0;
+			}
+		}
+	}
+
+	return true;
+}
+#endif
+
+// Binary snapshots, read in place through views without deserialising.
+// Layout, offsets are 32 bit and relative to the start of the snapshot:
+// - header: magic, version, root object offset, total size.
+// - object: field count followed by { name hash, type tag, value offset } entries in declaration order.
+// - scalars and enums: native bytes aligned to their size.
+// - strings: length, characters and a terminating null.
+// - vectors: element count and element tag, then the elements inline for scalars, or element offsets otherwise.
+// - maps: entry count, key tag and value tag followed by { key offset, value offset } pairs sorted by key.
+// Values are written before the object or container holding them, so their offsets are always smaller.
+// Null pointers and missing values have offset 0.
+// Snapshots use the native byte order and are only meant to be read on the architecture that wrote them.
+
+#define __CPP2JSON_SNAPSHOT_MAGIC 0x534A3243u
+#define __CPP2JSON_SNAPSHOT_VERSION 2u
+
+enum Cpp2JsonSnapshotKind
+{
+	Cpp2JsonSnapshotKindSigned = 1,
+	Cpp2JsonSnapshotKindUnsigned = 2,
+	Cpp2JsonSnapshotKindFloat = 3,
+	Cpp2JsonSnapshotKindString = 4,
+	Cpp2JsonSnapshotKindObject = 5,
+	Cpp2JsonSnapshotKindVector = 6,
+	Cpp2JsonSnapshotKindMap = 7
+};
+
+// FNV-1a hash of field names.
+inline constexpr uint32_t Cpp2JsonSnapshotHash(const char* name, uint32_t hash = 2166136261u)
+{
+	return *name == '\0' ? hash : Cpp2JsonSnapshotHash(name + 1, (hash ^ static_cast<uint8_t>(*name)) * 16777619u);
+}
+
+// Tags of vectors and maps keep their kind in the low byte and mix the tags of their elements in the other bits.
+inline constexpr uint32_t Cpp2JsonSnapshotCompositeTag(uint32_t kind, uint32_t firstTag, uint32_t secondTag = 0)
+{
+	return ((((2166136261u ^ firstTag) * 16777619u) ^ secondTag) * 16777619u & ~0xFFu) | kind;
+}
+
+inline uint32_t Cpp2JsonSnapshotRead32(const char* snapshot, uint32_t offset)
+{
+	uint32_t value;
+	memcpy(&value, snapshot + offset, sizeof(value));
+	return value;
+}
+
+// String stored in a snapshot.
+class Cpp2JsonSnapshotString
+{
+public:
+
+	Cpp2JsonSnapshotString(const char* data, uint32_t length)
+		: m_data(data)
+		, m_length(length)
+	{
+
+	}
+
+	inline const char* c_str() const { return m_data; }
+	inline size_t size() const { return m_length; }
+	inline bool empty() const { return m_length == 0; }
+	inline std::string str() const { return std::string(m_data, m_length); }
+
+	int compare(const char* other, size_t otherLength) const
+	{
+		int result = memcmp(m_data, other, m_length < otherLength ? m_length : otherLength);
+
+		if (result != 0)
+		{
+			return result;
+		}
+
+		return m_length < otherLength ? -1 : (m_length > otherLength ? 1 : 0);
+	}
+
+	inline bool operator==(const std::string& other) const { return compare(other.c_str(), other.size()) == 0; }
+	inline bool operator==(const char* other) const { return compare(other, strlen(other)) == 0; }
+	inline bool operator!=(const std::string& other) const { return !(*this == other); }
+	inline bool operator!=(const char* other) const { return !(*this == other); }
+
+private:
+
+	const char* m_data;
+	size_t m_length;
+};
+
+template<class T> class Cpp2JsonSnapshotView;
+template<class T> class Cpp2JsonSnapshotVectorView;
+template<class T, class R> class Cpp2JsonSnapshotMapView;
+
+// Maps a field type to the view returned when reading it from a snapshot.
+// The primary template handles serialisable objects.
+template<class T, class Enable = void>
+struct Cpp2JsonSnapshotAccess
+{
+	typedef Cpp2JsonSnapshotView<T> Result;
+	static const uint32_t Tag = Cpp2JsonSnapshotKindObject;
+	static const bool Inline = false;
+
+	static Result Get(const char* snapshot, uint32_t offset) { return Result(snapshot, offset); }
+};
+
+template<class T>
+struct Cpp2JsonSnapshotAccess<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type>
+{
+	typedef T Result;
+	static const uint32_t Tag = (sizeof(T) << 8) | (std::is_floating_point<T>::value ? Cpp2JsonSnapshotKindFloat : (std::is_signed<T>::value ? Cpp2JsonSnapshotKindSigned : Cpp2JsonSnapshotKindUnsigned));
+	static const bool Inline = true;
+
+	static Result Get(const char* snapshot, uint32_t offset)
+	{
+		T value = T();
+
+		if (offset != 0)
+		{
+			memcpy(&value, snapshot + offset, sizeof(T));
+		}
+
+		return value;
+	}
+};
+
+struct Cpp2JsonSnapshotStringAccess
+{
+	typedef Cpp2JsonSnapshotString Result;
+	static const uint32_t Tag = Cpp2JsonSnapshotKindString;
+	static const bool Inline = false;
+
+	static Result Get(const char* snapshot, uint32_t offset)
+	{
+		if (offset == 0)
+		{
+			return Result("", 0);
+		}
+
+		return Result(snapshot + offset + sizeof(uint32_t), Cpp2JsonSnapshotRead32(snapshot, offset));
+	}
+};
+
+template<>
+struct Cpp2JsonSnapshotAccess<std::string> : Cpp2JsonSnapshotStringAccess {};
+
+template<>
+struct Cpp2JsonSnapshotAccess<Cpp2JsonInternedString> : Cpp2JsonSnapshotStringAccess {};
+
+template<size_t Capacity>
+struct Cpp2JsonSnapshotAccess<Cpp2JsonInlineString<Capacity>> : Cpp2JsonSnapshotStringAccess {};
+
+template<class T>
+struct Cpp2JsonSnapshotAccess<T*> : Cpp2JsonSnapshotAccess<T> {};
+
+template<class T>
+struct Cpp2JsonSnapshotAccess<std::shared_ptr<T>> : Cpp2JsonSnapshotAccess<T> {};
+
+template<class T>
+struct Cpp2JsonSnapshotVectorAccess
+{
+	typedef Cpp2JsonSnapshotVectorView<T> Result;
+	static const uint32_t Tag = Cpp2JsonSnapshotCompositeTag(Cpp2JsonSnapshotKindVector, Cpp2JsonSnapshotAccess<T>::Tag);
+	static const bool Inline = false;
+
+	static Result Get(const char* snapshot, uint32_t offset) { return Result(snapshot, offset); }
+};
+
+template<class T>
+struct Cpp2JsonSnapshotAccess<std::vector<T>> : Cpp2JsonSnapshotVectorAccess<T> {};
+
+template<class T, size_t Size>
+struct Cpp2JsonSnapshotAccess<std::array<T, Size>> : Cpp2JsonSnapshotVectorAccess<T> {};
+
+template<class T, size_t Capacity>
+struct Cpp2JsonSnapshotAccess<Cpp2JsonSmallVector<T, Capacity>> : Cpp2JsonSnapshotVectorAccess<T> {};
+
+template<class T, class R>
+struct Cpp2JsonSnapshotAccess<std::map<T, R>>
+{
+	typedef Cpp2JsonSnapshotMapView<T, R> Result;
+	static const uint32_t Tag = Cpp2JsonSnapshotCompositeTag(Cpp2JsonSnapshotKindMap, Cpp2JsonSnapshotAccess<T>::Tag, Cpp2JsonSnapshotAccess<R>::Tag);
+	static const bool Inline = false;
+
+	static Result Get(const char* snapshot, uint32_t offset) { return Result(snapshot, offset); }
+};
+
+// Read only view of a serialisable object stored in a snapshot.
+// Fields are looked up by the names declared in CPP2JSON_SERIALISATION, e.g.:
+// float x = view.Get<float>("x");
+// Cpp2JsonSnapshotView<Position> position = view.Get<Position>("position");
+template<class T>
+class Cpp2JsonSnapshotView
+{
+public:
+
+	Cpp2JsonSnapshotView(const char* snapshot, uint32_t offset)
+		: m_snapshot(snapshot)
+		, m_offset(offset)
+	{
+
+	}
+
+	inline bool IsNull() const { return m_offset == 0; }
+
+	bool Has(const char* fieldName) const
+	{
+		return findField(Cpp2JsonSnapshotHash(fieldName)) != 0;
+	}
+
+	// Missing fields, and fields stored with another type, read as default values, empty strings, empty containers or null views.
+	template<class FieldType>
+	typename Cpp2JsonSnapshotAccess<FieldType>::Result Get(const char* fieldName) const
+	{
+		uint32_t entryOffset = findField(Cpp2JsonSnapshotHash(fieldName));
+		uint32_t valueOffset = 0;
+
+		if (entryOffset != 0 && Cpp2JsonSnapshotRead32(m_snapshot, entryOffset + sizeof(uint32_t)) == Cpp2JsonSnapshotAccess<FieldType>::Tag)
+		{
+			valueOffset = Cpp2JsonSnapshotRead32(m_snapshot, entryOffset + 2 * sizeof(uint32_t));
+		}
+
+		return Cpp2JsonSnapshotAccess<FieldType>::Get(m_snapshot, valueOffset);
+	}
+
+private:
+
+	// Returns the offset of the field entry, 0 if the field is not stored.
+	uint32_t findField(uint32_t nameHash) const
+	{
+		if (m_offset == 0)
+		{
+			return 0;
+		}
+
+		uint32_t fieldCount = Cpp2JsonSnapshotRead32(m_snapshot, m_offset);
+		uint32_t entryOffset = m_offset + sizeof(uint32_t);
+
+		for (uint32_t i = 0; i < fieldCount; ++i, entryOffset += 3 * sizeof(uint32_t))
+		{
+			if (Cpp2JsonSnapshotRead32(m_snapshot, entryOffset) == nameHash)
+			{
+				return entryOffset;
+			}
+		}
+
+		return 0;
+	}
+
+	const char* m_snapshot;
+	uint32_t m_offset;
+};
+
+// Read only view of a vector, std::array or Cpp2JsonSmallVector stored in a snapshot.
+template<class T>
+class Cpp2JsonSnapshotVectorView
+{
+public:
+
+	typedef typename Cpp2JsonSnapshotAccess<T>::Result Result;
+
+	Cpp2JsonSnapshotVectorView(const char* snapshot, uint32_t offset)
+		: m_snapshot(snapshot)
+		, m_offset(offset)
+	{
+
+	}
+
+	inline size_t size() const { return m_offset == 0 ? 0 : Cpp2JsonSnapshotRead32(m_snapshot, m_offset); }
+	inline bool empty() const { return size() == 0; }
+
+	Result operator[](size_t index) const
+	{
+		assert(index < size());
+
+		if (Cpp2JsonSnapshotAccess<T>::Inline)
+		{
+			return Cpp2JsonSnapshotAccess<T>::Get(m_snapshot, static_cast<uint32_t>(m_offset + 2 * sizeof(uint32_t) + index * sizeof(T)));
+		}
+
+		return Cpp2JsonSnapshotAccess<T>::Get(m_snapshot, Cpp2JsonSnapshotRead32(m_snapshot, static_cast<uint32_t>(m_offset + (index + 2) * sizeof(uint32_t))));
+	}
+
+	// Scalar elements are stored contiguously and aligned, they can be used in place.
+	const T* data() const
+	{
+		static_assert(Cpp2JsonSnapshotAccess<T>::Inline, "Only vectors of scalars are stored contiguously.");
+
+		return m_offset == 0 ? nullptr : reinterpret_cast<const T*>(m_snapshot + m_offset + 2 * sizeof(uint32_t));
+	}
+
+private:
+
+	const char* m_snapshot;
+	uint32_t m_offset;
+};
+
+// Read only view of a map stored in a snapshot.
+// Entries keep the order of std::map so keys can be found with a binary search.
+template<class T, class R>
+class Cpp2JsonSnapshotMapView
+{
+public:
+
+	typedef typename Cpp2JsonSnapshotAccess<T>::Result KeyResult;
+	typedef typename Cpp2JsonSnapshotAccess<R>::Result ValueResult;
+
+	Cpp2JsonSnapshotMapView(const char* snapshot, uint32_t offset)
+		: m_snapshot(snapshot)
+		, m_offset(offset)
+	{
+
+	}
+
+	inline size_t size() const { return m_offset == 0 ? 0 : Cpp2JsonSnapshotRead32(m_snapshot, m_offset); }
+	inline bool empty() const { return size() == 0; }
+
+	KeyResult KeyAt(size_t index) const
+	{
+		assert(index < size());
+		return Cpp2JsonSnapshotAccess<T>::Get(m_snapshot, Cpp2JsonSnapshotRead32(m_snapshot, entryOffset(index)));
+	}
+
+	ValueResult ValueAt(size_t index) const
+	{
+		assert(index < size());
+		return Cpp2JsonSnapshotAccess<R>::Get(m_snapshot, Cpp2JsonSnapshotRead32(m_snapshot, entryOffset(index) + sizeof(uint32_t)));
+	}
+
+	// Returns the entry index of key, or size() if the key is not stored.
+	template<class Key>
+	size_t Find(const Key& key) const
+	{
+		size_t first = 0;
+		size_t last = size();
+
+		while (first < last)
+		{
+			size_t middle = first + (last - first) / 2;
+			int comparison = compareKey(KeyAt(middle), key);
+
+			if (comparison == 0)
+			{
+				return middle;
+			}
+
+			if (comparison < 0)
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+
+		return size();
+	}
+
+	template<class Key>
+	inline bool Contains(const Key& key) const { return Find(key) != size(); }
+
+	template<class Key>
+	ValueResult At(const Key& key) const
+	{
+		size_t index = Find(key);
+		assert(index != size());
+		return index != size() ? ValueAt(index) : Cpp2JsonSnapshotAccess<R>::Get(m_snapshot, 0);
+	}
+
+private:
+
+	inline uint32_t entryOffset(size_t index) const
+	{
+		return static_cast<uint32_t>(m_offset + 3 * sizeof(uint32_t) + index * 2 * sizeof(uint32_t));
+	}
+
+	static int compareKey(const Cpp2JsonSnapshotString& storedKey, const std::string& key)
+	{
+		return storedKey.compare(key.c_str(), key.size());
+	}
+
+	static int compareKey(const Cpp2JsonSnapshotString& storedKey, const Cpp2JsonInternedString& key)
+	{
+		return storedKey.compare(key.c_str(), key.size());
+	}
+
+	static int compareKey(const Cpp2JsonSnapshotString& storedKey, const char* key)
+	{
+		return storedKey.compare(key, strlen(key));
+	}
+
+	template<class StoredKey, class Key>
+	static auto compareKey(StoredKey storedKey, Key key) -> typename std::enable_if<std::is_arithmetic<StoredKey>::value || std::is_enum<StoredKey>::value, int>::type
+	{
+		return storedKey < key ? -1 : (key < storedKey ? 1 : 0);
+	}
+
+	const char* m_snapshot;
+	uint32_t m_offset;
+};
+
+template<class T>
+Cpp2JsonSnapshotView<T> Cpp2JsonGetSnapshotRoot(const char* snapshot)
+{
+	assert(Cpp2JsonSnapshotRead32(snapshot, 0) == __CPP2JSON_SNAPSHOT_MAGIC);
+	assert(Cpp2JsonSnapshotRead32(snapshot, sizeof(uint32_t)) == __CPP2JSON_SNAPSHOT_VERSION);
+
+	return Cpp2JsonSnapshotView<T>(snapshot, Cpp2JsonSnapshotRead32(snapshot, 2 * sizeof(uint32_t)));
+}
+
+// Writes serialisable objects in the snapshot layout.
+class Cpp2JsonSnapshotWriter
+{
+public:
+
+	Cpp2JsonSnapshotWriter(std::string& output)
+		: m_output(output)
+		, m_overflow(false)
+	{
+
+	}
+
+	// Offsets are 32 bit, returns false and leaves the output empty when the snapshot would exceed 4 GiB.
+	template<class T>
+	auto write(const T& obj) -> decltype(obj.cpp2json_internal_serialise(*this), bool())
+	{
+		m_output.clear();
+		m_overflow = false;
+
+		uint32_t header[4] = { __CPP2JSON_SNAPSHOT_MAGIC, __CPP2JSON_SNAPSHOT_VERSION, 0, 0 };
+		m_output.append(reinterpret_cast<const char*>(header), sizeof(header));
+
+		header[2] = writeValue(obj);
+
+		if (m_overflow || m_output.size() > UINT32_MAX)
+		{
+			m_output.clear();
+			m_entries.clear();
+			return false;
+		}
+
+		header[3] = static_cast<uint32_t>(m_output.size());
+
+		memcpy(&m_output[0], header, sizeof(header));
+
+		return true;
+	}
+
+	template<class T>
+	Cpp2JsonSnapshotWriter& operator()(const char* name, const T& field)
+	{
+		uint32_t valueOffset = writeValue(field);
+		uint32_t typeTag = Cpp2JsonSnapshotAccess<T>::Tag;
+
+		m_entries.push_back(Cpp2JsonSnapshotHash(name));
+		m_entries.push_back(typeTag);
+		m_entries.push_back(valueOffset);
+
+		return *this;
+	}
+
+private:
+
+	// Fields are written before their object, entries wait on m_entries until the object is complete.
+	template<class T>
+	auto writeValue(const T& obj) -> decltype(obj.cpp2json_internal_serialise(*this), uint32_t())
+	{
+		size_t firstEntry = m_entries.size();
+
+		obj.cpp2json_internal_serialise(*this);
+
+#ifndef NDEBUG
+		// Fields are only found by name hash, two names of one object must not share a hash.
+		for (size_t i = firstEntry; i < m_entries.size(); i += 3)
+		{
+			for (size_t j = i + 3; j < m_entries.size(); j += 3)
+			{
+				assert(m_entries[i] != m_entries[j]);
+			}
+		}
+#endif
+
+		uint32_t offset = align(sizeof(uint32_t));
+		append(static_cast<uint32_t>((m_entries.size() - firstEntry) / 3));
+		m_output.append(reinterpret_cast<const char*>(m_entries.data() + firstEntry), (m_entries.size() - firstEntry) * sizeof(uint32_t));
+
+		m_entries.resize(firstEntry);
+
+		return offset;
+	}
+
+	template<class T>
+	uint32_t writeValue(const T* obj)
+	{
+		return obj != nullptr ? writeValue(*obj) : 0;
+	}
+
+	template<class T>
+	uint32_t writeValue(const std::shared_ptr<T>& obj)
+	{
+		return obj ? writeValue(*obj) : 0;
+	}
+
+	template<class T>
+	auto writeValue(T value) -> typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value, uint32_t>::type
+	{
+		uint32_t offset = align(sizeof(T));
+		append(value);
+		return offset;
+	}
+
+	uint32_t writeValue(const std::string& value)
+	{
+		return writeString(value.c_str(), value.size());
+	}
+
+	uint32_t writeValue(const Cpp2JsonInternedString& value)
+	{
+		return writeString(value.c_str(), value.size());
+	}
+
+	template<size_t Capacity>
+	uint32_t writeValue(const Cpp2JsonInlineString<Capacity>& value)
+	{
+		return writeString(value.c_str(), value.size());
+	}
+
+	template<class T>
+	uint32_t writeValue(const std::vector<T>& value)
+	{
+		return writeVector(value.data(), value.size());
+	}
+
+	uint32_t writeValue(const std::vector<bool>& value)
+	{
+		uint32_t offset = align(2 * sizeof(uint32_t));
+		append(static_cast<uint32_t>(value.size()));
+		append(Cpp2JsonSnapshotAccess<bool>::Tag);
+
+		for (size_t i = 0; i < value.size(); ++i)
+		{
+			append(static_cast<bool>(value[i]));
+		}
+
+		return offset;
+	}
+
+	template<class T, size_t Size>
+	uint32_t writeValue(const std::array<T, Size>& value)
+	{
+		return writeVector(value.data(), value.size());
+	}
+
+	template<class T, size_t Capacity>
+	uint32_t writeValue(const Cpp2JsonSmallVector<T, Capacity>& value)
+	{
+		return writeVector(value.data(), value.size());
+	}
+
+	template<typename T, typename R>
+	uint32_t writeValue(const std::map<T, R>& value)
+	{
+		size_t firstEntry = m_entries.size();
+
+		for (auto it = value.begin(); it != value.end(); ++it)
+		{
+			uint32_t keyOffset = writeValue(it->first);
+			uint32_t valueOffset = writeValue(it->second);
+
+			m_entries.push_back(keyOffset);
+			m_entries.push_back(valueOffset);
+		}
+
+		uint32_t offset = align(sizeof(uint32_t));
+		append(static_cast<uint32_t>(value.size()));
+		append(Cpp2JsonSnapshotAccess<T>::Tag);
+		append(Cpp2JsonSnapshotAccess<R>::Tag);
+		m_output.append(reinterpret_cast<const char*>(m_entries.data() + firstEntry), (m_entries.size() - firstEntry) * sizeof(uint32_t));
+
+		m_entries.resize(firstEntry);
+
+		return offset;
+	}
+
+	// Scalars are copied in a single block after the element count.
+	template<class T>
+	auto writeVector(const T* values, size_t count) -> typename std::enable_if<Cpp2JsonSnapshotAccess<T>::Inline, uint32_t>::type
+	{
+		uint32_t offset = align(2 * sizeof(uint32_t));
+		append(static_cast<uint32_t>(count));
+		append(Cpp2JsonSnapshotAccess<T>::Tag);
+
+		m_output.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+
+		return offset;
+	}
+
+	template<class T>
+	auto writeVector(const T* values, size_t count) -> typename std::enable_if<!Cpp2JsonSnapshotAccess<T>::Inline, uint32_t>::type
+	{
+		size_t firstEntry = m_entries.size();
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t valueOffset = writeValue(values[i]);
+			m_entries.push_back(valueOffset);
+		}
+
+		uint32_t offset = align(sizeof(uint32_t));
+		append(static_cast<uint32_t>(count));
+		append(Cpp2JsonSnapshotAccess<T>::Tag);
+		m_output.append(reinterpret_cast<const char*>(m_entries.data() + firstEntry), count * sizeof(uint32_t));
+
+		m_entries.resize(firstEntry);
+
+		return offset;
+	}
+
+	uint32_t writeString(const char* value, size_t length)
+	{
+		uint32_t offset = align(sizeof(uint32_t));
+		append(static_cast<uint32_t>(length));
+		m_output.append(value, length);
+		m_output.push_back('\0');
+		return offset;
+	}
+
+	template<class T>
+	inline void append(T value)
+	{
+		m_output.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	// Pads the output to a multiple of alignment (8 at most) and returns the aligned offset.
+	// Offsets past 4 GiB cannot be stored, write() then fails.
+	uint32_t align(size_t alignment)
+	{
+		if (alignment > 8)
+		{
+			alignment = 8;
+		}
+
+		m_output.resize((m_output.size() + alignment - 1) & ~(alignment - 1), '\0');
+
+		if (m_output.size() > UINT32_MAX)
+		{
+			m_overflow = true;
+			return 0;
+		}
+
+		return static_cast<uint32_t>(m_output.size());
+	}
+
+	std::string& m_output;
+	std::vector<uint32_t> m_entries;
+	bool m_overflow;
+};
+
+// Returns an empty string when the object does not fit in a snapshot.
+template<class T>
+std::string Cpp2JsonGetSnapshot(const T& obj)
+{
+	std::string snapshot;
+	Cpp2JsonSnapshotWriter snapshotWriter = Cpp2JsonSnapshotWriter(snapshot);
+	snapshotWriter.write(obj);
+	return snapshot;
+}
+
+// Snapshot file mapped in memory, pages are shared by every process mapping the same file.
+// Falls back to reading the file when memory mapping is not available.
+class Cpp2JsonSnapshotFile
+{
+public:
+
+	Cpp2JsonSnapshotFile()
+		: m_data(nullptr)
+		, m_size(0)
+	{
+
+	}
+
+	~Cpp2JsonSnapshotFile()
+	{
+		Close();
+	}
+
+	bool Open(const char* path)
+	{
+		Close();
+
+#ifdef CPP2JSON_HAS_MMAP
+		int fileDescriptor = open(path, O_RDONLY);
+
+		if (fileDescriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat fileStat;
+
+		if (fstat(fileDescriptor, &fileStat) == 0 && fileStat.st_size > 0)
+		{
+			void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+
+			if (mapping != MAP_FAILED)
+			{
+				m_data = static_cast<const char*>(mapping);
+				m_size = static_cast<size_t>(fileStat.st_size);
+			}
+		}
+
+		close(fileDescriptor);
+#else
+		std::ifstream file(path, std::ios::binary);
+
+		if (file)
+		{
+			std::stringstream contents;
+			contents << file.rdbuf();
+			m_buffer = contents.str();
+			m_data = m_buffer.data();
+			m_size = m_buffer.size();
+		}
+#endif
+
+		if (m_data != nullptr && !isValid())
+		{
+			Close();
+		}
+
+		return m_data != nullptr;
+	}
+
+	void Close()
+	{
+#ifdef CPP2JSON_HAS_MMAP
+		if (m_data != nullptr)
+		{
+			munmap(const_cast<char*>(m_data), m_size);
+		}
+#else
+		m_buffer.clear();
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	template<class T>
+	inline Cpp2JsonSnapshotView<T> GetRoot() const { return Cpp2JsonGetSnapshotRoot<T>(m_data); }
+
+	inline const char* Data() const { return m_data; }
+	inline size_t Size() const { return m_size; }
+
+private:
+
+	struct PendingValue
+	{
+		uint32_t tag;
+		uint32_t offset;
+		uint32_t end;
+	};
+
+	// Truncated, partially written or corrupted files are rejected, every stored offset and length must stay within the data.
+	bool isValid() const
+	{
+		const size_t headerSize = 4 * sizeof(uint32_t);
+
+		if (m_size < headerSize
+			|| Cpp2JsonSnapshotRead32(m_data, 0) != __CPP2JSON_SNAPSHOT_MAGIC
+			|| Cpp2JsonSnapshotRead32(m_data, sizeof(uint32_t)) != __CPP2JSON_SNAPSHOT_VERSION
+			|| Cpp2JsonSnapshotRead32(m_data, 3 * sizeof(uint32_t)) != m_size)
+		{
+			return false;
+		}
+
+		uint32_t rootOffset = Cpp2JsonSnapshotRead32(m_data, 2 * sizeof(uint32_t));
+
+		if (rootOffset == 0)
+		{
+			return false;
+		}
+
+		// The writer never shares values, each one takes at least a byte. Bounding the number of values
+		// keeps the pass linear on files whose offsets point to the same value many times.
+		size_t remainingValues = m_size - 1;
+
+		std::vector<PendingValue> pending;
+		pending.push_back({ Cpp2JsonSnapshotKindObject, rootOffset, static_cast<uint32_t>(m_size) });
+
+		while (!pending.empty())
+		{
+			PendingValue value = pending.back();
+			pending.pop_back();
+
+			if (!isValidValue(value, pending, remainingValues))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Values are written before their parent, so they must end before the parent's offset.
+	bool isValidValue(const PendingValue& value, std::vector<PendingValue>& pending, size_t& remainingValues) const
+	{
+		if (value.offset == 0)
+		{
+			return true;
+		}
+
+		if (value.offset < 4 * sizeof(uint32_t) || value.offset >= value.end)
+		{
+			return false;
+		}
+
+		const uint64_t available = value.end - value.offset;
+		const uint32_t kind = value.tag & 0xFF;
+
+		if (kind == Cpp2JsonSnapshotKindString)
+		{
+			if (value.tag != Cpp2JsonSnapshotKindString || available < sizeof(uint32_t))
+			{
+				return false;
+			}
+
+			uint64_t length = Cpp2JsonSnapshotRead32(m_data, value.offset);
+
+			return available >= sizeof(uint32_t) + length + 1 && m_data[value.offset + sizeof(uint32_t) + length] == '\0';
+		}
+
+		if (kind == Cpp2JsonSnapshotKindObject)
+		{
+			if (value.tag != Cpp2JsonSnapshotKindObject || available < sizeof(uint32_t))
+			{
+				return false;
+			}
+
+			uint32_t fieldCount = Cpp2JsonSnapshotRead32(m_data, value.offset);
+
+			if (available < sizeof(uint32_t) + 3 * sizeof(uint32_t) * static_cast<uint64_t>(fieldCount) || fieldCount > remainingValues)
+			{
+				return false;
+			}
+
+			remainingValues -= fieldCount;
+
+			for (uint32_t i = 0; i < fieldCount; ++i)
+			{
+				uint32_t entryOffset = value.offset + sizeof(uint32_t) + i * 3 * sizeof(uint32_t);
+				pending.push_back({ Cpp2JsonSnapshotRead32(m_data, entryOffset + sizeof(uint32_t)), Cpp2JsonSnapshotRead32(m_data, entryOffset + 2 * sizeof(uint32_t)), value.offset });
+			}
+
+			return true;
+		}
+
+		if (kind == Cpp2JsonSnapshotKindVector)
+		{
+			if (available < 2 * sizeof(uint32_t))
+			{
+				return false;
+			}
+
+			uint32_t count = Cpp2JsonSnapshotRead32(m_data, value.offset);
+			uint32_t elementTag = Cpp2JsonSnapshotRead32(m_data, value.offset + sizeof(uint32_t));
+
+			if (value.tag != Cpp2JsonSnapshotCompositeTag(Cpp2JsonSnapshotKindVector, elementTag))
+			{
+				return false;
+			}
+
+			// Scalars are stored inline and used in place through data(), they must be aligned.
+			if (isScalarTag(elementTag))
+			{
+				return value.offset % 8 == 0 && available >= 2 * sizeof(uint32_t) + static_cast<uint64_t>(count) * (elementTag >> 8);
+			}
+
+			if (available < 2 * sizeof(uint32_t) + sizeof(uint32_t) * static_cast<uint64_t>(count) || count > remainingValues)
+			{
+				return false;
+			}
+
+			remainingValues -= count;
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				pending.push_back({ elementTag, Cpp2JsonSnapshotRead32(m_data, value.offset + (i + 2) * sizeof(uint32_t)), value.offset });
+			}
+
+			return true;
+		}
+
+		if (kind == Cpp2JsonSnapshotKindMap)
+		{
+			if (available < 3 * sizeof(uint32_t))
+			{
+				return false;
+			}
+
+			uint32_t count = Cpp2JsonSnapshotRead32(m_data, value.offset);
+			uint32_t keyTag = Cpp2JsonSnapshotRead32(m_data, value.offset + sizeof(uint32_t));
+			uint32_t valueTag = Cpp2JsonSnapshotRead32(m_data, value.offset + 2 * sizeof(uint32_t));
+
+			if (value.tag != Cpp2JsonSnapshotCompositeTag(Cpp2JsonSnapshotKindMap, keyTag, valueTag)
+				|| available < 3 * sizeof(uint32_t) + 2 * sizeof(uint32_t) * static_cast<uint64_t>(count)
+				|| count > remainingValues / 2)
+			{
+				return false;
+			}
+
+			remainingValues -= 2 * static_cast<size_t>(count);
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint32_t entryOffset = value.offset + (3 + 2 * i) * sizeof(uint32_t);
+				pending.push_back({ keyTag, Cpp2JsonSnapshotRead32(m_data, entryOffset), value.offset });
+				pending.push_back({ valueTag, Cpp2JsonSnapshotRead32(m_data, entryOffset + sizeof(uint32_t)), value.offset });
+			}
+
+			return true;
+		}
+
+		return isScalarTag(value.tag) && available >= (value.tag >> 8);
+	}
+
+	static bool isScalarTag(uint32_t tag)
+	{
+		uint32_t kind = tag & 0xFF;
+		uint32_t size = tag >> 8;
+
+		return (kind == Cpp2JsonSnapshotKindSigned || kind == Cpp2JsonSnapshotKindUnsigned || kind == Cpp2JsonSnapshotKindFloat)
+			&& (size == 1 || size == 2 || size == 4 || size == 8);
+	}
+
+	Cpp2JsonSnapshotFile(const Cpp2JsonSnapshotFile&) = delete;
+	Cpp2JsonSnapshotFile& operator=(const Cpp2JsonSnapshotFile&) = delete;
+
+	const char* m_data;
+	size_t m_size;
+
+#ifndef CPP2JSON_HAS_MMAP
+	std::string m_buffer;
+#endif
+};
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CPP2JSON_BIG_ENDIAN 1
+#endif
+
+// Hashes serialisable fields without formatting them, e.g. to detect changes or as a cache key.
+// Values are hashed in little endian byte order with XXH64, results are stable across runs and platforms.
+class Cpp2JsonHasher
+{
+public:
+
+	Cpp2JsonHasher(uint64_t seed = 0)
+		: m_totalLength(0)
+		, m_bufferSize(0)
+	{
+		m_lanes[0] = seed + Prime1 + Prime2;
+		m_lanes[1] = seed + Prime2;
+		m_lanes[2] = seed;
+		m_lanes[3] = seed - Prime1;
+	}
+
+	template<class T>
+	auto write(const T& obj) -> decltype(obj.cpp2json_internal_serialise(*this), void())
+	{
+		hashValue(obj);
+	}
+
+	template<class T>
+	Cpp2JsonHasher& operator()(const char* name, const T& field)
+	{
+		update(name, strlen(name));
+		hashValue(field);
+		return *this;
+	}
+
+	uint64_t GetHash() const
+	{
+		uint64_t hash;
+
+		if (m_totalLength >= StripeSize)
+		{
+			hash = rotateLeft(m_lanes[0], 1) + rotateLeft(m_lanes[1], 7) + rotateLeft(m_lanes[2], 12) + rotateLeft(m_lanes[3], 18);
+
+			for (int i = 0; i < 4; ++i)
+			{
+				hash = (hash ^ laneRound(0, m_lanes[i])) * Prime1 + Prime4;
+			}
+		}
+		else
+		{
+			hash = m_lanes[2] + Prime5;
+		}
+
+		hash += m_totalLength;
+
+		size_t position = 0;
+
+		for (; position + 8 <= m_bufferSize; position += 8)
+		{
+			hash ^= laneRound(0, read64(m_buffer + position));
+			hash = rotateLeft(hash, 27) * Prime1 + Prime4;
+		}
+
+		if (position + 4 <= m_bufferSize)
+		{
+			hash ^= static_cast<uint64_t>(read32(m_buffer + position)) * Prime1;
+			hash = rotateLeft(hash, 23) * Prime2 + Prime3;
+			position += 4;
+		}
+
+		for (; position < m_bufferSize; ++position)
+		{
+			hash ^= static_cast<uint64_t>(m_buffer[position]) * Prime5;
+			hash = rotateLeft(hash, 11) * Prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= Prime2;
+		hash ^= hash >> 29;
+		hash *= Prime3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
+	// Adds raw bytes to the hash.
+	void update(const void* data, size_t length)
+	{
+		// Empty ranges, e.g. the data of an empty vector, may be null.
+		if (length == 0)
+		{
+			return;
+		}
+
+		const uint8_t* input = static_cast<const uint8_t*>(data);
+		const uint8_t* end = input + length;
+
+		m_totalLength += length;
+
+		if (m_bufferSize + length < StripeSize)
+		{
+			memcpy(m_buffer + m_bufferSize, input, length);
+			m_bufferSize += length;
+			return;
+		}
+
+		if (m_bufferSize > 0)
+		{
+			size_t fill = StripeSize - m_bufferSize;
+			memcpy(m_buffer + m_bufferSize, input, fill);
+			consumeStripe(m_buffer);
+			input += fill;
+			m_bufferSize = 0;
+		}
+
+		// Large inputs such as numeric vectors go through the four independent lanes without copying.
+		for (; input + StripeSize <= end; input += StripeSize)
+		{
+			consumeStripe(input);
+		}
+
+		m_bufferSize = static_cast<size_t>(end - input);
+		memcpy(m_buffer, input, m_bufferSize);
+	}
+
+private:
+
+	static const uint64_t Prime1 = 11400714785074694791ULL;
+	static const uint64_t Prime2 = 14029467366897019727ULL;
+	static const uint64_t Prime3 = 1609587929392839161ULL;
+	static const uint64_t Prime4 = 9650029242287828579ULL;
+	static const uint64_t Prime5 = 2870177450012600261ULL;
+	static const size_t StripeSize = 32;
+
+	template<class T>
+	auto hashValue(const T& obj) -> decltype(obj.cpp2json_internal_serialise(*this), void())
+	{
+		// Object boundaries keep nested fields from hashing like sibling fields.
+		hashMarker('{');
+		obj.cpp2json_internal_serialise(*this);
+		hashMarker('}');
+	}
+
+	template<class T>
+	void hashValue(const T* obj)
+	{
+		hashMarker(obj != nullptr ? 1 : 0);
+
+		if (obj != nullptr)
+		{
+			hashValue(*obj);
+		}
+	}
+
+	template<class T>
+	void hashValue(const std::shared_ptr<T>& obj)
+	{
+		hashValue(obj.get());
+	}
+
+	template<class T>
+	auto hashValue(T value) -> typename std::enable_if<std::is_arithmetic<T>::value>::type
+	{
+#ifdef CPP2JSON_BIG_ENDIAN
+		uint8_t bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+
+		for (size_t i = 0; i < sizeof(T) / 2; ++i)
+		{
+			std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+		}
+
+		update(bytes, sizeof(T));
+#else
+		update(&value, sizeof(T));
+#endif
 	}
 
 	template<class T>
-	void addNewVectorEntry(std::vector<T*>& vector, const rapidjson::Value& document) 
+	auto hashValue(T value) -> typename std::enable_if<std::is_enum<T>::value>::type
 	{
-		T* newEntry = new T();
+		hashValue(static_cast<typename std::underlying_type<T>::type>(value));
+	}
 
-		newEntry->cpp2json_internal_deserialise(*this);
+	void hashValue(const std::string& value)
+	{
+		hashString(value.c_str(), value.size());
+	}
 
-		vector.push_back(newEntry);
+	void hashValue(const Cpp2JsonInternedString& value)
+	{
+		hashString(value.c_str(), value.size());
+	}
+
+	template<size_t Capacity>
+	void hashValue(const Cpp2JsonInlineString<Capacity>& value)
+	{
+		hashString(value.c_str(), value.size());
 	}
 
 	template<class T>
-	void addNewVectorEntry(std::vector<std::shared_ptr<T>>& vector, const rapidjson::Value& document) 
+	void hashValue(const std::vector<T>& value)
 	{
-		std::shared_ptr<T> newEntry = std::make_shared<T>();
+		hashRange(value.data(), value.size());
+	}
 
-		newEntry->cpp2json_internal_deserialise(*this);
+	void hashValue(const std::vector<bool>& value)
+	{
+		hashValue(static_cast<uint64_t>(value.size()));
 
-		vector.push_back(newEntry);
+		for (size_t i = 0; i < value.size(); ++i)
+		{
+			hashValue(static_cast<bool>(value[i]));
+		}
 	}
 
-	template<typename T, typename R>
-	void addNewMapEntry(std::map<T, R>& map, T& key, const rapidjson::Value& document) 
+	template<class T, size_t Size>
+	void hashValue(const std::array<T, Size>& value)
 	{
-		R newValue = R();
-
-		read(newValue, __CPP2JSON_JSON_MAP_VALUE_TAG, document);
+		hashRange(value.data(), value.size());
+	}
 
-		map[key] = newValue;
+	template<class T, size_t Capacity>
+	void hashValue(const Cpp2JsonSmallVector<T, Capacity>& value)
+	{
+		hashRange(value.data(), value.size());
 	}
 
 	template<typename T, typename R>
-	void addNewMapEntry(std::map<T, R*>& map, T& key, const rapidjson::Value& document) 
+	void hashValue(const std::map<T, R>& value)
 	{
-		R* newValue = new R();
+		hashValue(static_cast<uint64_t>(value.size()));
 
-		read(newValue, __CPP2JSON_JSON_MAP_VALUE_TAG, document);
+		for (auto it = value.begin(); it != value.end(); ++it)
+		{
+			hashValue(it->first);
+			hashValue(it->second);
+		}
+	}
 
-		map[key] = newValue;
+	template<class T, class R>
+	void hashValue(const std::pair<T, R>& value)
+	{
+		hashValue(value.first);
+		hashValue(value.second);
 	}
 
-	template<typename T, typename R>
-	void addNewMapEntry(std::map<T, std::shared_ptr<R>>& map, T& key, const rapidjson::Value& document) 
+	template<class... T>
+	void hashValue(const std::tuple<T...>& value)
 	{
-		std::shared_ptr<R> newValue = std::make_shared<R>();
+		hashTupleEntries<0>(value);
+	}
 
-		read(newValue, __CPP2JSON_JSON_MAP_VALUE_TAG, document);
+	template<size_t Index, class... T>
+	auto hashTupleEntries(const std::tuple<T...>& value) -> typename std::enable_if<(Index < sizeof...(T))>::type
+	{
+		hashValue(std::get<Index>(value));
+		hashTupleEntries<Index + 1>(value);
+	}
+
+	template<size_t Index, class... T>
+	auto hashTupleEntries(const std::tuple<T...>& value) -> typename std::enable_if<Index == sizeof...(T)>::type
+	{
 
-		map[key] = newValue;
 	}
 
+#ifdef CPP2JSON_HAS_OPTIONAL
 	template<class T>
-	void read(std::vector<T>& value, const char* fieldName, const rapidjson::Value& document) 
+	void hashValue(const std::optional<T>& value)
 	{
-		value = std::vector<T>();
+		hashMarker(value.has_value() ? 1 : 0);
 
-		if (document[fieldName].IsArray())
+		if (value.has_value())
 		{
-			const rapidjson::Value& itemsArray = document[fieldName];
-			for (rapidjson::SizeType i = 0; i < itemsArray.Size(); i++)
-			{
-				const rapidjson::Value& itemElement = itemsArray[i];
-
-				bool isObject = itemElement.IsObject();
+			hashValue(*value);
+		}
+	}
+#endif
 
-				if (isObject)
-				{
-					documentToParse.push(&itemElement);
-				}
+	// Contiguous numeric values are hashed as a single block.
+	template<class T>
+	auto hashRange(const T* values, size_t count) -> typename std::enable_if<std::is_arithmetic<T>::value>::type
+	{
+		hashValue(static_cast<uint64_t>(count));
 
-				addNewVectorEntry(value, itemElement);
+#ifdef CPP2JSON_BIG_ENDIAN
+		for (size_t i = 0; i < count; ++i)
+		{
+			hashValue(values[i]);
+		}
+#else
+		update(values, count * sizeof(T));
+#endif
+	}
 
-				if (isObject)
-				{
-					documentToParse.pop();	
-				}
+	template<class T>
+	auto hashRange(const T* values, size_t count) -> typename std::enable_if<!std::is_arithmetic<T>::value>::type
+	{
+		hashValue(static_cast<uint64_t>(count));
 
-			}
-		}
-		else
+		for (size_t i = 0; i < count; ++i)
 		{
-			assert(false);
+			hashValue(values[i]);
 		}
-
 	}
 
-	template<typename T, typename R>
-	void read(std::map<T,R>& value, const char* fieldName, const rapidjson::Value& document) 
+	void hashString(const char* value, size_t length)
 	{
-		value = std::map<T,R>();
+		hashValue(static_cast<uint64_t>(length));
+		update(value, length);
+	}
 
-		if (document[fieldName].IsArray())
-		{
-			const rapidjson::Value& itemsArray = document[fieldName];
-			for (rapidjson::SizeType i = 0; i < itemsArray.Size(); i++)
-			{
-				const rapidjson::Value& itemElement = itemsArray[i];
+	inline void hashMarker(uint8_t marker)
+	{
+		update(&marker, sizeof(marker));
+	}
 
-				if (itemElement.IsObject())
-				{
-					if (!(itemElement.HasMember(__CPP2JSON_JSON_MAP_KEY_TAG) && itemElement.HasMember(__CPP2JSON_JSON_MAP_VALUE_TAG)))
-					{
-						assert(false);
-					}
-					else
-					{
-						T newKey = T();
-						R newValue = R();
+	void consumeStripe(const uint8_t* stripe)
+	{
+		m_lanes[0] = laneRound(m_lanes[0], read64(stripe));
+		m_lanes[1] = laneRound(m_lanes[1], read64(stripe + 8));
+		m_lanes[2] = laneRound(m_lanes[2], read64(stripe + 16));
+		m_lanes[3] = laneRound(m_lanes[3], read64(stripe + 24));
+	}
 
-						read(newKey, __CPP2JSON_JSON_MAP_KEY_TAG, itemElement);
+	static inline uint64_t rotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
 
-						if (itemElement[__CPP2JSON_JSON_MAP_VALUE_TAG].IsObject())
-						{
-							const rapidjson::Value& objToPush = itemElement[__CPP2JSON_JSON_MAP_VALUE_TAG];
-							documentToParse.push(&objToPush);
-						}
+	static inline uint64_t laneRound(uint64_t lane, uint64_t input)
+	{
+		return rotateLeft(lane + input * Prime2, 31) * Prime1;
+	}
 
-						addNewMapEntry(value, newKey, itemElement);
-						
-					}
-				}
-				else
-				{
-					assert(false);
-				}
-				
-			}
-		}
-		else
+	static inline uint64_t read64(const uint8_t* data)
+	{
+		uint64_t value = 0;
+#ifdef CPP2JSON_BIG_ENDIAN
+		for (int i = 7; i >= 0; --i)
 		{
-			assert(false);
+			value = (value << 8) | data[i];
 		}
+#else
+		memcpy(&value, data, sizeof(value));
+#endif
+		return value;
 	}
 
-	std::stack<const rapidjson::Value*> documentToParse;
+	static inline uint32_t read32(const uint8_t* data)
+	{
+		uint32_t value = 0;
+#ifdef CPP2JSON_BIG_ENDIAN
+		for (int i = 3; i >= 0; --i)
+		{
+			value = (value << 8) | data[i];
+		}
+#else
+		memcpy(&value, data, sizeof(value));
+#endif
+		return value;
+	}
 
+	uint64_t m_lanes[4];
+	uint64_t m_totalLength;
+	uint8_t m_buffer[StripeSize];
+	size_t m_bufferSize;
 };
 
-// Copied from:
-// https://gist.github.com/judofyr/18cc1e9e4f48a13483c00d1c86e34cf5
-
-class Cpp2JsonWriter 
+template<class T>
+uint64_t Cpp2JsonGetHash(const T& obj, uint64_t seed = 0)
 {
+	Cpp2JsonHasher hasher = Cpp2JsonHasher(seed);
+	hasher.write(obj);
+	return hasher.GetHash();
+}
 
+// Deep copies serialisable fields from one object to another without going through JSON.
+// Pointer fields get their own copy of the pointee, destination objects and containers are reused where possible.
+class Cpp2JsonCloner
+{
 public:
 
-	Cpp2JsonWriter(std::stringstream& output) 
-		: m_output(output)
+	Cpp2JsonCloner()
+		: m_nextField(0)
 	{
 
 	}
 
 	template<class T>
-	auto write(const T& obj) -> decltype(obj.cpp2json_internal_serialise(*this), void())
+	auto clone(const T& source, T& destination) -> decltype(destination.cpp2json_internal_deserialise(*this), void())
 	{
-		m_output << "{";
-		m_needsComma = false;
-		obj.cpp2json_internal_serialise(*this);
-		m_output << "}";
+		cloneValue(source, destination);
 	}
 
 	template<class T>
-	Cpp2JsonWriter& operator()(const char* name, const T& field)
+	Cpp2JsonCloner& operator()(const char* name, T& field)
 	{
-		if (m_needsComma) 
-		{
-			m_output << ",";
-		}
-		m_needsComma = true;
-		m_output << "\"" << name << "\"" << ":";
-		write(field);
+		// Fields are visited in the same order in both objects, the source field has the same type.
+		const T& sourceField = *static_cast<const T*>(m_sourceFields[m_nextField++]);
+		cloneValue(sourceField, field);
 		return *this;
 	}
 
 private:
 
 	template<class T>
-	auto write(const T* obj) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	auto cloneValue(const T& source, T& destination) -> decltype(destination.cpp2json_internal_deserialise(*this), void())
 	{
-		m_output << "{";
-		m_needsComma = false;
-		obj->cpp2json_internal_serialise(*this);
-		m_output << "}";
+		if (&source == &destination)
+		{
+			return;
+		}
+
+		size_t firstField = m_sourceFields.size();
+		size_t nextField = m_nextField;
+
+		Cpp2JsonFieldCollector collector = Cpp2JsonFieldCollector(m_sourceFields);
+		source.cpp2json_internal_serialise(collector);
+
+		m_nextField = firstField;
+		destination.cpp2json_internal_deserialise(*this);
+
+		m_sourceFields.resize(firstField);
+		m_nextField = nextField;
 	}
 
 	template<class T>
-	auto write(const std::shared_ptr<T> obj) -> decltype(obj->cpp2json_internal_serialise(*this), void())
+	auto cloneValue(const T& source, T& destination) -> typename std::enable_if<Cpp2JsonIsPlainValue<T>::value>::type
 	{
-		m_output << "{";
-		m_needsComma = false;
-		obj->cpp2json_internal_serialise(*this);
-		m_output << "}";
+		destination = source;
 	}
-    
-    void write(unsigned int value)
-    {
-        m_output << value;
-    }
-    
-    void write(uint64_t value)
-    {
-        m_output << value;
-    }
 
-	void write(int value)
+	// As when deserialising, raw pointers already set in the destination are reused and never deleted.
+	template<class T>
+	void cloneValue(T* const& source, T*& destination)
 	{
-		m_output << value;
+		if (source == nullptr)
+		{
+			destination = nullptr;
+			return;
+		}
+
+		if (destination == nullptr || destination == source)
+		{
+			destination = new T();
+		}
+
+		cloneValue(*source, *destination);
 	}
-    
-    void write(int64_t value)
-    {
-        m_output << value;
-    }
 
-	void write(float value) 
+	// Pointees shared with other owners are never written to, a new one is allocated instead.
+	template<class T>
+	void cloneValue(const std::shared_ptr<T>& source, std::shared_ptr<T>& destination)
 	{
-		m_output << value;
+		if (!source)
+		{
+			destination.reset();
+			return;
+		}
+
+		if (!destination || destination.use_count() > 1)
+		{
+			destination = std::make_shared<T>();
+		}
+
+		cloneValue(*source, *destination);
 	}
 
-	void write(double value) 
+	template<class T>
+	auto cloneValue(const std::vector<T>& source, std::vector<T>& destination) -> typename std::enable_if<!Cpp2JsonIsPlainValue<T>::value>::type
 	{
-		m_output << value;
+		destination.resize(source.size());
+
+		for (size_t i = 0; i < source.size(); ++i)
+		{
+			cloneValue(source[i], destination[i]);
+		}
 	}
 
-	void write(const std::string& value) 
+	template<class T, size_t Size>
+	auto cloneValue(const std::array<T, Size>& source, std::array<T, Size>& destination) -> typename std::enable_if<!Cpp2JsonIsPlainValue<T>::value>::type
 	{
-		m_output << '"' << value << '"';
+		for (size_t i = 0; i < Size; ++i)
+		{
+			cloneValue(source[i], destination[i]);
+		}
 	}
-    
-    void write(bool value)
-    {
-        m_output << (value ? "true" : "false");
-    }
 
-	template<class T>
-	void write(const std::vector<T>& value) 
+	template<class T, size_t Capacity>
+	auto cloneValue(const Cpp2JsonSmallVector<T, Capacity>& source, Cpp2JsonSmallVector<T, Capacity>& destination) -> typename std::enable_if<!Cpp2JsonIsPlainValue<T>::value>::type
 	{
-		m_output << "[";
+		destination.resize(source.size());
 
-		for (size_t i = 0; i < value.size(); ++i)
+		for (size_t i = 0; i < source.size(); ++i)
 		{
-			write(value.at(i));
+			cloneValue(source[i], destination[i]);
+		}
+	}
 
-			if (i < value.size() - 1)
+	// Both maps are sorted, destination entries with a matching key are reused.
+	template<typename T, typename R>
+	auto cloneValue(const std::map<T, R>& source, std::map<T, R>& destination) -> typename std::enable_if<!Cpp2JsonIsPlainValue<std::map<T, R>>::value>::type
+	{
+		auto destinationIt = destination.begin();
+
+		for (auto sourceIt = source.begin(); sourceIt != source.end(); ++sourceIt)
+		{
+			while (destinationIt != destination.end() && destination.key_comp()(destinationIt->first, sourceIt->first))
 			{
-				m_output << ",";
+				destinationIt = destination.erase(destinationIt);
+			}
+
+			if (destinationIt == destination.end() || destination.key_comp()(sourceIt->first, destinationIt->first))
+			{
+				destinationIt = destination.insert(destinationIt, std::make_pair(sourceIt->first, R()));
 			}
+
+			cloneValue(sourceIt->second, destinationIt->second);
+			++destinationIt;
 		}
 
-		m_output << "]";
+		destination.erase(destinationIt, destination.end());
 	}
 
-	template<typename T, typename R>
-	void write(const std::map<T,R>& value) 
+	template<class T, class R>
+	auto cloneValue(const std::pair<T, R>& source, std::pair<T, R>& destination) -> typename std::enable_if<!Cpp2JsonIsPlainValue<std::pair<T, R>>::value>::type
 	{
-		m_output << "[";
+		cloneValue(source.first, destination.first);
+		cloneValue(source.second, destination.second);
+	}
 
-		for( auto it = value.begin(); it != value.end();)
-		{
-			m_output << "{ \"" << __CPP2JSON_JSON_MAP_KEY_TAG << "\": ";
-			write(it->first);
+	template<class... T>
+	auto cloneValue(const std::tuple<T...>& source, std::tuple<T...>& destination) -> typename std::enable_if<!Cpp2JsonIsPlainValue<std::tuple<T...>>::value>::type
+	{
+		cloneTupleEntries<0>(source, destination);
+	}
 
-			m_output << ", \"" << __CPP2JSON_JSON_MAP_VALUE_TAG << "\": ";
-			write(it->second);
+	template<size_t Index, class... T>
+	auto cloneTupleEntries(const std::tuple<T...>& source, std::tuple<T...>& destination) -> typename std::enable_if<(Index < sizeof...(T))>::type
+	{
+		cloneValue(std::get<Index>(source), std::get<Index>(destination));
+		cloneTupleEntries<Index + 1>(source, destination);
+	}
 
-			m_output << "}";
+	template<size_t Index, class... T>
+	auto cloneTupleEntries(const std::tuple<T...>& source, std::tuple<T...>& destination) -> typename std::enable_if<Index == sizeof...(T)>::type
+	{
 
-			++it;
+	}
 
-			if (it != value.end())
-			{
-				m_output << ",";
-			}
+#ifdef CPP2JSON_HAS_OPTIONAL
+	template<class T>
+	auto cloneValue(const std::optional<T>& source, std::optional<T>& destination) -> typename std::enable_if<!Cpp2JsonIsPlainValue<T>::value>::type
+	{
+		if (!source.has_value())
+		{
+			destination.reset();
+			return;
 		}
 
-		m_output << "]";
+		if (!destination.has_value())
+		{
+			destination.emplace();
+		}
+
+		cloneValue(*source, *destination);
 	}
+#endif
 
-	std::stringstream& m_output;
-	bool m_needsComma;
+	// Source fields of the objects being cloned, the innermost object's fields are last.
+	std::vector<const void*> m_sourceFields;
+	size_t m_nextField;
 };
+
+template<class T>
+void Cpp2JsonClone(const T& source, T& destination)
+{
+	Cpp2JsonCloner cloner = Cpp2JsonCloner();
+	cloner.clone(source, destination);
+}
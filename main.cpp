@@ -1,5 +1,12 @@
 #include "cpp2json.h"
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+
+#ifdef CPP2JSON_HAS_WRITEV
+#include <thread>
+#include <unistd.h>
+#endif
 
 // Creates different classes to showcase serialisation for all supported types.
 
@@ -45,12 +52,12 @@ public:
 	Character() 
 	{
 		position = Position();
-		sprite = "";
+		sprite = Cpp2JsonInternedString();
 	}
 
 	Character(const Position& aposition, const std::string& asprite)
 		: position(aposition)
-		, sprite(asprite)
+		, sprite(Cpp2JsonStringPool::GetDefault().Intern(asprite))
 	{
 
 	}
@@ -58,8 +65,8 @@ public:
 	inline const Position& GetPosition() const { return position; }
 	inline void SetPosition(const Position& aposition) { position = aposition; }
 
-	inline const std::string& GetSprite() const { return sprite; }
-	inline void SetSprite(const std::string& asprite) { sprite = asprite; }
+	inline const std::string& GetSprite() const { return sprite.Get(); }
+	inline void SetSprite(const std::string& asprite) { sprite = Cpp2JsonStringPool::GetDefault().Intern(asprite); }
 
 	CPP2JSON_SERIALISATION
 	(
@@ -70,7 +77,9 @@ public:
 private:
 
 	Position position;
-	std::string sprite;
+
+	// Sprite names are shared by many characters, only one copy of each is kept.
+	Cpp2JsonInternedString sprite;
 
 };
 
@@ -92,6 +101,8 @@ public:
 
 	}
 
+	inline float GetHealth() const { return health; }
+
 	// Ensures the serialisable properties in Character are included.
 	CPP2JSON_DECLARE_BASE_CLASS(Character)
 
@@ -114,6 +125,8 @@ public:
 		team = std::map<std::string, std::shared_ptr<Character>>();
 
 		player = std::make_shared<Player>(Position(0, 0), "player.png");
+
+		spawnPoints[1] = Position(10, 10);
 	}
 
 	GameMap(int aid)
@@ -123,6 +136,8 @@ public:
 		team = std::map<std::string, std::shared_ptr<Character>>();
 
 		player = std::make_shared<Player>(Position(0, 0), "player.png");
+
+		spawnPoints[1] = Position(10, 10);
 	}
 
 	inline void AddEnemy(std::shared_ptr<Character> enemy)
@@ -140,12 +155,24 @@ public:
 		return team.at(memberId)->GetPosition();
 	}
 
+	inline int GetId() const { return id; }
+	inline size_t GetEnemyCount() const { return enemies.size(); }
+	inline const Character& GetEnemy(size_t index) const { return *enemies[index]; }
+	inline size_t GetTeamSize() const { return team.size(); }
+	inline const Player& GetPlayer() const { return *player; }
+
+	inline void SetSpawnPoint(size_t index, const Position& position)
+	{
+		spawnPoints[index] = position;
+	}
+
 	CPP2JSON_SERIALISATION
 	(
 		id,
 		enemies,
 		team,
-		player
+		player,
+		spawnPoints
 	)
 
 private:
@@ -156,6 +183,90 @@ private:
 	std::map<std::string, std::shared_ptr<Character>> team;
 
 	std::shared_ptr<Player> player;
+
+	// Elements of arrays are read in place, sparse output compares them to the values set by the constructor.
+	std::array<Position, 2> spawnPoints;
+};
+
+enum class Direction
+{
+	North,
+	South
+};
+
+// Written as "north" and "south" instead of integers.
+CPP2JSON_DECLARE_ENUM_NAMES(Direction, { Direction::North, "north" }, { Direction::South, "south" })
+
+// No name table, written as integers.
+enum Rarity
+{
+	RarityCommon,
+	RarityRare = 5
+};
+
+// Fixed size and standard library value types.
+class Loadout : public Cpp2JsonSerialisable
+{
+public:
+	Loadout()
+		: facing(Direction::North)
+		, rarity(RarityCommon)
+		, ammo("arrows", 0)
+		, slot(0, 0.0f, "")
+	{
+
+	}
+
+	inline void SetFacing(Direction afacing) { facing = afacing; }
+	inline void SetRarity(Rarity ararity) { rarity = ararity; }
+	inline void SetAmmo(const std::string& type, int count) { ammo = std::make_pair(type, count); }
+	inline void SetSlot(int index, float weight, const char* label) { slot = std::make_tuple(index, weight, Cpp2JsonInlineString<8>(label)); }
+	inline void SetName(const char* aname) { name = aname; }
+	inline void AddWaypoint(const Position& waypoint) { waypoints.push_back(waypoint); }
+
+	inline const Cpp2JsonInlineString<8>& GetName() const { return name; }
+	inline size_t GetWaypointCount() const { return waypoints.size(); }
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	inline void SetTarget(const Position& atarget) { target = atarget; }
+
+	CPP2JSON_SERIALISATION
+	(
+		facing,
+		rarity,
+		ammo,
+		slot,
+		name,
+		waypoints,
+		target
+	)
+#else
+	CPP2JSON_SERIALISATION
+	(
+		facing,
+		rarity,
+		ammo,
+		slot,
+		name,
+		waypoints
+	)
+#endif
+
+private:
+
+	Direction facing;
+	Rarity rarity;
+
+	std::pair<std::string, int> ammo;
+	std::tuple<int, float, Cpp2JsonInlineString<8>> slot;
+
+	// Inline storage, longer names and extra waypoints are dropped.
+	Cpp2JsonInlineString<8> name;
+	Cpp2JsonSmallVector<Position, 4> waypoints;
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	std::optional<Position> target;
+#endif
 };
 
 int main() 
@@ -170,6 +281,9 @@ int main()
 	gameMap.AddTeamMember("barbarian", barbarian);
 	gameMap.AddTeamMember("knight", knight);
 
+	// y is 0 as in Position(), but differs from the constructor's spawn point so it must still be written in sparse mode.
+	gameMap.SetSpawnPoint(1, Position(10, 0));
+
 	for (uint32_t i = 0; i < 500; ++i)
 	{
 		std::shared_ptr<Character> enemy = std::make_shared<Character>(Position(0.0f,static_cast<float>(3+i)), "enemy.png");
@@ -178,9 +292,13 @@ int main()
 
 	const std::string& serialisationStr = gameMap.Cpp2JsonGetSerialisationString();
 
-	GameMap clone = GameMap();
+	// Repeated string values such as "enemy.png" are stored once in the pool.
+	// Declared before clone, interned strings must not outlive their pool.
+	Cpp2JsonStringPool stringPool;
 
-	clone.Cpp2JsonDeserialise(serialisationStr);
+	GameMap clone = GameMap();
+	clone.Cpp2JsonDeserialise(serialisationStr, &stringPool);
+	std::cout << "\nInterned strings: " << stringPool.Size();
 
 	// Verification: Do we have a wizard at 0,0?
 	bool foundWizard = clone.GetTeamMemberPosition("wizard").GetX() == 0;
@@ -199,6 +317,204 @@ int main()
 		std::cout << "\nFailure! Serialisation strings do not match.\n" << serialisationStr << "\n\n" << cloneSerialisationStr;
 	}
 
+	// Deep copy without going through JSON.
+	GameMap directClone = GameMap();
+	Cpp2JsonClone(gameMap, directClone);
+
+	if (directClone.Cpp2JsonGetSerialisationString() == serialisationStr)
+	{
+		std::cout << "\n\nSuccess! Identical clone.";
+	}
+	else
+	{
+		std::cout << "\n\nFailure! Clone does not match.";
+	}
+
+	// Parsing with the SIMD structural index gives the same object.
+	GameMap indexedClone = GameMap();
+	indexedClone.Cpp2JsonDeserialise(serialisationStr, nullptr, Cpp2JsonParseBackendStructuralIndex);
+
+	if (indexedClone.Cpp2JsonGetSerialisationString() == serialisationStr)
+	{
+		std::cout << "\nSuccess! Identical structural index parse.";
+	}
+	else
+	{
+		std::cout << "\nFailure! Structural index parse does not match.";
+	}
+
+	// Identical objects hash the same, any change to a serialisable field changes the hash.
+	bool identicalHash = Cpp2JsonGetHash(directClone) == Cpp2JsonGetHash(gameMap);
+
+	directClone.AddTeamMember("rogue", std::make_shared<Character>(Position(3,0), "rogue.png"));
+	bool changedHash = Cpp2JsonGetHash(directClone) != Cpp2JsonGetHash(gameMap);
+
+	if (identicalHash && changedHash)
+	{
+		std::cout << "\nSuccess! Hashes match the objects.";
+	}
+	else
+	{
+		std::cout << "\nFailure! Hashes do not match the objects.";
+	}
+
+	// Fields left at their default values are not written.
+	const std::string& sparseSerialisationStr = gameMap.Cpp2JsonGetSerialisationString(Cpp2JsonWriteModeSparse);
+
+	GameMap sparseClone = GameMap();
+	sparseClone.Cpp2JsonDeserialise(sparseSerialisationStr);
+
+	if (sparseClone.Cpp2JsonGetSerialisationString() == serialisationStr)
+	{
+		std::cout << "\nSuccess! Identical sparse clone, " << sparseSerialisationStr.size() << " bytes instead of " << serialisationStr.size() << ".";
+	}
+	else
+	{
+		std::cout << "\nFailure! Sparse clone does not match.";
+	}
+
+#ifdef CPP2JSON_HAS_WRITEV
+	// Segmented output sent through a pipe arrives as the length followed by the same JSON.
+	// The low reference threshold makes the chain reference the sprite names instead of copying them.
+	Cpp2JsonSegmentChain chain(4096, 8);
+	Cpp2JsonWriter chainWriter = Cpp2JsonWriter(chain);
+	chainWriter.write(gameMap);
+
+	int pipeDescriptors[2];
+	bool identicalFrame = pipe(pipeDescriptors) == 0;
+
+	if (identicalFrame)
+	{
+		// The frame can be larger than the pipe's buffer, it is drained while being written.
+		std::string received;
+		std::thread receiver([&received, &pipeDescriptors]()
+		{
+			char buffer[4096];
+			ssize_t length;
+
+			while ((length = read(pipeDescriptors[0], buffer, sizeof(buffer))) > 0)
+			{
+				received.append(buffer, static_cast<size_t>(length));
+			}
+		});
+
+		identicalFrame = Cpp2JsonWriteFramed(pipeDescriptors[1], chain);
+		close(pipeDescriptors[1]);
+
+		receiver.join();
+		close(pipeDescriptors[0]);
+
+		size_t frameLength = received.size() < 4 ? 0 : (static_cast<size_t>(static_cast<unsigned char>(received[0])) << 24)
+			| (static_cast<size_t>(static_cast<unsigned char>(received[1])) << 16)
+			| (static_cast<size_t>(static_cast<unsigned char>(received[2])) << 8)
+			| static_cast<size_t>(static_cast<unsigned char>(received[3]));
+
+		identicalFrame = identicalFrame && frameLength == serialisationStr.size() && received.compare(4, std::string::npos, serialisationStr) == 0;
+	}
+
+	if (identicalFrame)
+	{
+		std::cout << "\nSuccess! Identical framed output, " << chain.GetSegments().size() << " segments.";
+	}
+	else
+	{
+		std::cout << "\nFailure! Framed output does not match.";
+	}
+#endif
+
+	// Snapshots are read in place from the mapped file and hold the same values as the object.
+	const std::string& snapshot = Cpp2JsonGetSnapshot(gameMap);
+	std::ofstream("gameMap.snapshot", std::ios::binary).write(snapshot.data(), snapshot.size());
+
+	Cpp2JsonSnapshotFile snapshotFile;
+	bool identicalSnapshot = snapshotFile.Open("gameMap.snapshot");
+
+	if (identicalSnapshot)
+	{
+		Cpp2JsonSnapshotView<GameMap> mapView = snapshotFile.GetRoot<GameMap>();
+		identicalSnapshot = mapView.Get<int>("id") == gameMap.GetId();
+
+		Cpp2JsonSnapshotVectorView<std::shared_ptr<Character>> enemiesView = mapView.Get<std::vector<std::shared_ptr<Character>>>("enemies");
+		identicalSnapshot = identicalSnapshot && enemiesView.size() == gameMap.GetEnemyCount();
+
+		for (size_t i = 0; identicalSnapshot && i < enemiesView.size(); ++i)
+		{
+			const Character& enemy = gameMap.GetEnemy(i);
+			Cpp2JsonSnapshotView<Position> positionView = enemiesView[i].Get<Position>("position");
+
+			identicalSnapshot = positionView.Get<float>("x") == enemy.GetPosition().GetX() && positionView.Get<float>("y") == enemy.GetPosition().GetY()
+				&& enemiesView[i].Get<Cpp2JsonInternedString>("sprite") == enemy.GetSprite();
+		}
+
+		Cpp2JsonSnapshotMapView<std::string, std::shared_ptr<Character>> teamView = mapView.Get<std::map<std::string, std::shared_ptr<Character>>>("team");
+		identicalSnapshot = identicalSnapshot && teamView.size() == gameMap.GetTeamSize();
+
+		for (size_t i = 0; identicalSnapshot && i < teamView.size(); ++i)
+		{
+			const Position& position = gameMap.GetTeamMemberPosition(teamView.KeyAt(i).str());
+			Cpp2JsonSnapshotView<Position> positionView = teamView.ValueAt(i).Get<Position>("position");
+
+			identicalSnapshot = positionView.Get<float>("x") == position.GetX() && positionView.Get<float>("y") == position.GetY();
+		}
+
+		Cpp2JsonSnapshotView<Player> playerView = mapView.Get<std::shared_ptr<Player>>("player");
+		identicalSnapshot = identicalSnapshot && playerView.Get<float>("health") == gameMap.GetPlayer().GetHealth()
+			&& playerView.Get<Cpp2JsonInternedString>("sprite") == gameMap.GetPlayer().GetSprite();
+
+		// Reading a field with another type gives an empty view.
+		identicalSnapshot = identicalSnapshot && mapView.Get<std::vector<int>>("enemies").empty();
+	}
+
+	snapshotFile.Close();
+	std::remove("gameMap.snapshot");
+
+	if (identicalSnapshot)
+	{
+		std::cout << "\nSuccess! Identical snapshot, " << snapshot.size() << " bytes.";
+	}
+	else
+	{
+		std::cout << "\nFailure! Snapshot does not match.";
+	}
+
+	// Enums, standard library values and inline containers read back identically, inline values are truncated to their capacity.
+	Loadout loadout = Loadout();
+	loadout.SetFacing(Direction::South);
+	loadout.SetRarity(RarityRare);
+	loadout.SetAmmo("bolts", 12);
+	loadout.SetSlot(2, 1.5f, "quiver");
+	loadout.SetName("longbowman");
+
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		loadout.AddWaypoint(Position(static_cast<float>(i), 0.0f));
+	}
+
+#ifdef CPP2JSON_HAS_OPTIONAL
+	loadout.SetTarget(Position(4, 2));
+#endif
+
+	const std::string& loadoutSerialisationStr = loadout.Cpp2JsonGetSerialisationString();
+
+	Loadout loadoutClone = Loadout();
+	loadoutClone.Cpp2JsonDeserialise(loadoutSerialisationStr);
+
+	// Values read from JSON are truncated as well.
+	Loadout truncatedLoadout = Loadout();
+	truncatedLoadout.Cpp2JsonDeserialise("{\"name\":\"crossbowman\",\"waypoints\":[{},{},{},{},{},{}]}");
+
+	bool truncated = loadout.GetName() == "longbowm" && loadout.GetWaypointCount() == 4
+		&& truncatedLoadout.GetName() == "crossbow" && truncatedLoadout.GetWaypointCount() == 4;
+
+	if (loadoutClone.Cpp2JsonGetSerialisationString() == loadoutSerialisationStr && truncated)
+	{
+		std::cout << "\nSuccess! Identical value types.\n" << loadoutSerialisationStr;
+	}
+	else
+	{
+		std::cout << "\nFailure! Value types do not match.\n" << loadoutSerialisationStr << "\n\n" << loadoutClone.Cpp2JsonGetSerialisationString();
+	}
+
 	std::cout << "\n";
 
 }
\ No newline at end of file